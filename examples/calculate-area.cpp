@@ -116,6 +116,7 @@ int main(int argc, char *argv[])
     saddlebags::cycle(worker, true);
 
     // close down UPC++ runtime
+    saddlebags::destroy_worker(worker);
     saddlebags::finalize();
     return 0;
 } 
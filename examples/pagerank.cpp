@@ -38,6 +38,7 @@
 #define EXPORT_FORMATS_NUM_NEIGHBORS true
 #define EXPORT_FORMATS_SEP '\t'
 #define INITIAL_RESERVE_SIZE_MAX_EDGES 50
+#define PAGERANK_BATCHED false // push to all links with push_many(), and take the pushes with on_push_batch()
 
 template<class Tk, class Ok, class Mt>
 class Vertex : public saddlebags::Item<Tk, Ok, Mt> {
@@ -46,7 +47,11 @@ class Vertex : public saddlebags::Item<Tk, Ok, Mt> {
     int vertex_id = 0;
     float page_rank = 1;
     float new_page_rank = 0;
+#if PAGERANK_BATCHED
+    std::vector<Ok> links;
+#else
     std::vector<int> links;
+#endif
 
     void add_link(int new_link) {
         this->links.emplace_back(new_link);
@@ -54,6 +59,17 @@ class Vertex : public saddlebags::Item<Tk, Ok, Mt> {
 
     void do_work() override {
         if (links.size() > 0) {
+#if PAGERANK_BATCHED
+            float pr = page_rank / ((float) links.size());
+            this->push_many(VERTEX_TABLE, this->links, pr);
+
+            if (pr <= 0 && SADDLEBAG_DEBUG > 5) {
+                std::cout << "[Rank " << saddlebags::rank_me() << "] "
+                          << "[Vertex " << vertex_id << "] "
+                          << "Page rank value is zero."
+                          << std::endl;
+            }
+#else
             for(auto it : this->links) {
                 float pr = page_rank / ((float) links.size());
                 if (pr > 0 || true) {
@@ -67,6 +83,7 @@ class Vertex : public saddlebags::Item<Tk, Ok, Mt> {
                               << std::endl;
                 }
             }
+#endif
         }
     }
 
@@ -74,6 +91,16 @@ class Vertex : public saddlebags::Item<Tk, Ok, Mt> {
         new_page_rank +=  0.15 * page_rank + 0.85 * val;
     }
 
+#if PAGERANK_BATCHED
+    void on_push_batch(const Mt* vals, std::size_t n) override {
+        float sum = 0;
+        for (std::size_t i = 0; i < n; i++) {
+            sum += vals[i];
+        }
+        new_page_rank += n * 0.15 * page_rank + 0.85 * sum;
+    }
+#endif
+
     void before_work() override {
         if (new_page_rank > 0) {
             page_rank = new_page_rank;
@@ -390,6 +417,17 @@ int main(int argc, char* argv[]) {
         max_size = atoi(argv[3]);
     }
 
+    // Phase timings and trace of each rank, written when the worker is destroyed
+    std::string timings_file;
+    if (argc > 4) {
+        timings_file = argv[4];
+    }
+
+    std::string trace_file;
+    if (argc > 5) {
+        trace_file = argv[5];
+    }
+
     saddlebags::init();
     bool isRankRoot = ( saddlebags::rank_me() == 0 );
     int rank_me = saddlebags::rank_me();
@@ -405,7 +443,7 @@ int main(int argc, char* argv[]) {
         int total_nodes = (int) upcxx::rank_n() / local_team.rank_n();
         total_nodes += upcxx::rank_n() % local_team.rank_n() == 0 ? 0 : 1;
         std::cout << "[Rank " << upcxx::rank_me() << "] "
-                  << "Usage: " << getFileName(argv[0]) << " <Path> <Iterations> <Buffer Size>" << std::endl;
+                  << "Usage: " << getFileName(argv[0]) << " <Path> <Iterations> <Buffer Size> <Timings File> <Trace File>" << std::endl;
         std::cout << "[Rank " << upcxx::rank_me() << "] "
                   << "Process " << upcxx::rank_me()
                   << " out of " << upcxx::rank_n() << "."
@@ -418,6 +456,12 @@ int main(int argc, char* argv[]) {
     auto start_time = std::chrono::high_resolution_clock::now();
     WorkerPageRank* worker = saddlebags::create_worker<uint8_t, unsigned int, float>(max_size);
     worker->add_table<Vertex>(VERTEX_TABLE);
+    if (!timings_file.empty()) {
+        worker->enable_phase_timings(timings_file);
+    }
+    if (!trace_file.empty()) {
+        worker->enable_trace(trace_file);
+    }
 
     int total_vertices = 0;
     int total_edges = 0;
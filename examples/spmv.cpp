@@ -414,6 +414,7 @@ int main(int argc, char* argv[]) {
                   << std::endl;
     }
 
+    saddlebags::destroy_worker(worker);
     saddlebags::finalize();
     return 0;
 }
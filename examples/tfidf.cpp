@@ -441,6 +441,7 @@ int main(int argc, char* argv[]) {
                   << std::endl;
     }
 
+    saddlebags::destroy_worker(worker);
     upcxx::finalize();
     return 0;
 }
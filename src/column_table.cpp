@@ -0,0 +1,315 @@
+// Copyright 2019 Saddlebag Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef COLUMN_TABLE_CPP
+#define COLUMN_TABLE_CPP
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "table.cpp"
+
+/*
+ * Columnar (structure of arrays) storage for numeric item fields.
+ *
+ * An item declares its columns by deriving from ColumnItem, e.g.
+ *
+ *   template<class Tk, class Ok, class Mt>
+ *   class Vertex : public saddlebags::ColumnItem<Tk, Ok, Mt, float, float> { ... };
+ *
+ * add_table() then creates a ColumnTableContainer, which keeps every column in
+ * one contiguous array indexed by the table slot of the item. Items read and
+ * write their own values through column<I>().
+ *
+ * An item type may also declare a column kernel,
+ *
+ *   static void work_columns(Columns& columns);
+ *
+ * which then runs once per cycle over the whole arrays, instead of the work
+ * hooks of the individual items.
+ */
+
+namespace saddlebags
+{
+
+template<typename... Fields>
+class ColumnList;
+
+template<>
+class ColumnList<> {
+    public:
+    void append() {}
+    void move(std::size_t, std::size_t) {}
+    void pop() {}
+    void clear() {}
+    void reserve(std::size_t) {}
+    void permute(const std::vector<std::size_t>&) {}
+    std::size_t bytes() const { return 0; }
+};
+
+template<typename Field, typename... Rest>
+class ColumnList<Field, Rest...> : public ColumnList<Rest...> {
+    public:
+    static_assert(std::is_trivially_copyable<Field>::value, "Columns can only hold POD fields");
+
+    std::vector<Field> values;
+
+    void append() {
+        values.push_back(Field());
+        ColumnList<Rest...>::append();
+    }
+
+    void move(std::size_t from, std::size_t to) {
+        values[to] = values[from];
+        ColumnList<Rest...>::move(from, to);
+    }
+
+    void pop() {
+        values.pop_back();
+        ColumnList<Rest...>::pop();
+    }
+
+    void clear() {
+        values.clear();
+        ColumnList<Rest...>::clear();
+    }
+
+    void reserve(std::size_t n) {
+        values.reserve(n);
+        ColumnList<Rest...>::reserve(n);
+    }
+
+    void permute(const std::vector<std::size_t>& order) {
+        std::vector<Field> permuted(order.size());
+        for (std::size_t i = 0; i < order.size(); i++) {
+            permuted[i] = values[order[i]];
+        }
+        values.swap(permuted);
+        ColumnList<Rest...>::permute(order);
+    }
+
+    std::size_t bytes() const {
+        return values.capacity() * sizeof(Field) + ColumnList<Rest...>::bytes();
+    }
+};
+
+template<std::size_t I, typename List>
+struct ColumnAt;
+
+template<typename Field, typename... Rest>
+struct ColumnAt<0, ColumnList<Field, Rest...>> {
+    using type = Field;
+
+    static std::vector<Field>& get(ColumnList<Field, Rest...>& list) {
+        return list.values;
+    }
+};
+
+template<std::size_t I, typename Field, typename... Rest>
+struct ColumnAt<I, ColumnList<Field, Rest...>> {
+    using type = typename ColumnAt<I - 1, ColumnList<Rest...>>::type;
+
+    static std::vector<type>& get(ColumnList<Field, Rest...>& list) {
+        return ColumnAt<I - 1, ColumnList<Rest...>>::get(list);
+    }
+};
+
+template<typename... Fields>
+class ColumnStore {
+    public:
+
+    template<std::size_t I>
+    using field_type = typename ColumnAt<I, ColumnList<Fields...>>::type;
+
+    std::size_t size = 0;
+    ColumnList<Fields...> list;
+
+    /**
+     * Contiguous array of column I, with one value per slot
+     */
+    template<std::size_t I>
+    field_type<I>* column() {
+        return ColumnAt<I, ColumnList<Fields...>>::get(list).data();
+    }
+
+    /**
+     * Append a zero-initialized value to all columns and return its slot
+     */
+    std::size_t add_slot() {
+        list.append();
+        return size++;
+    }
+
+    /**
+     * Remove a slot by moving the last slot into its place.
+     * Returns the previous index of the moved slot.
+     */
+    std::size_t remove_slot(std::size_t slot) {
+        std::size_t last = size - 1;
+        if (slot != last) {
+            list.move(last, slot);
+        }
+        list.pop();
+        size--;
+        return last;
+    }
+
+    /**
+     * Remove all slots
+     */
+    void clear() {
+        list.clear();
+        size = 0;
+    }
+
+    void reserve(std::size_t n) {
+        list.reserve(n);
+    }
+
+    /**
+     * Reorder all columns, so that slot i takes the values of slot order[i]
+     */
+    void permute(const std::vector<std::size_t>& order) {
+        list.permute(order);
+    }
+
+    std::size_t bytes() const {
+        return list.bytes();
+    }
+};
+
+template<class TableKey_T, class ItemKey_T, class Msg_T, typename... Fields>
+class ColumnItem : public Item<TableKey_T, ItemKey_T, Msg_T> {
+    public:
+    using Columns = ColumnStore<Fields...>;
+
+    Columns* columns = nullptr;
+
+    /**
+     * Value of column I for this item
+     */
+    template<std::size_t I>
+    typename Columns::template field_type<I>& column() {
+        return columns->template column<I>()[this->table_slot];
+    }
+};
+
+/*
+ * True for item types that declare columns (derived from ColumnItem)
+ */
+template<typename ItemType, typename = void>
+struct has_columns : std::false_type {};
+
+template<typename ItemType>
+struct has_columns<ItemType, typename std::conditional<true, void, typename ItemType::Columns>::type> : std::true_type {};
+
+/*
+ * True for column item types that declare a column kernel, static work_columns(Columns&)
+ */
+template<typename ItemType, typename = void>
+struct has_column_kernel : std::false_type {};
+
+template<typename ItemType>
+struct has_column_kernel<ItemType, typename std::conditional<true, void,
+    decltype(ItemType::work_columns(std::declval<typename ItemType::Columns&>()))>::type> : std::true_type {};
+
+template <typename TableKey_T, typename ItemKey_T, typename Msg_T, typename ItemType>
+class ColumnTableContainer : public TableContainer<TableKey_T, ItemKey_T, Msg_T, ItemType> {
+    public:
+
+    typename ItemType::Columns columns;
+
+    /*
+     * Columns follow the packed item list of the table, so each new item gets the next slot
+     */
+    void attach_item(ItemType* obj) override {
+        obj->columns = &columns;
+        columns.add_slot();
+        assert(obj->table_slot + 1 == columns.size);
+    }
+
+    /*
+     * Fill the hole with the last slot, the same way the item list is kept packed
+     */
+    void detach_item(ItemType* obj) override {
+        columns.remove_slot(obj->table_slot);
+    }
+
+    /*
+     *
+     */
+    void reserve_items(std::size_t n) override {
+        TableContainer<TableKey_T, ItemKey_T, Msg_T, ItemType>::reserve_items(n);
+        columns.reserve(n);
+    }
+
+    /*
+     * Columns follow the items when they are reordered
+     */
+    void reorder_slots(const std::vector<std::size_t>& old_slots) override {
+        TableContainer<TableKey_T, ItemKey_T, Msg_T, ItemType>::reorder_slots(old_slots);
+        columns.permute(old_slots);
+    }
+
+    /*
+     * Run the column kernel of the item type if it has one, otherwise the work hooks of the items
+     */
+    void work() override {
+        run_work(has_column_kernel<ItemType>());
+    }
+
+    /*
+     *
+     */
+    void account_memory(TableMemory& memory) override {
+        TableContainer<TableKey_T, ItemKey_T, Msg_T, ItemType>::account_memory(memory);
+        memory.column_bytes = columns.bytes();
+    }
+
+    /*
+     *
+     */
+    void destroy_items() override {
+        TableContainer<TableKey_T, ItemKey_T, Msg_T, ItemType>::destroy_items();
+        columns.clear();
+    }
+
+    private:
+
+    /*
+     * The kernel covers all slots, so activations of single items are used up without running them.
+     * With vote to halt, the items that were active stay active for the next cycle, unless they voted to halt.
+     */
+    void run_work(std::true_type) {
+        if (this->active_scheduling) {
+            this->start_running();
+        }
+        this->begin_work();
+        ItemType::work_columns(columns);
+        this->end_work();
+        if (this->keep_active) {
+            this->keep_unhalted_active();
+        }
+    }
+
+    void run_work(std::false_type) {
+        TableContainer<TableKey_T, ItemKey_T, Msg_T, ItemType>::work();
+    }
+};
+
+}//end namespace
+
+#endif
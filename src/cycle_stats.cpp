@@ -0,0 +1,357 @@
+// Copyright 2019 Saddlebag Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CYCLE_STATS_CPP
+#define CYCLE_STATS_CPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "utils.hpp"
+
+//Per-cycle measurements of a Worker, kept on each rank and written out at shutdown
+
+namespace saddlebags
+{
+
+/**
+ * Phases of a cycle, in the order they are reported
+ */
+enum CyclePhase {
+    PhaseBarrier,     // Waiting for the other ranks, at the start of the cycle and after receiving
+    PhaseSizeRget,    // Fetching the sizes of remote buffers
+    PhaseBufferRget,  // Waiting for remote buffers to arrive
+    PhaseLocalRecv,   // Delivering messages from this rank and ranks on the same node, and batched pushes
+    PhaseRemoteRecv,  // Delivering messages from ranks on other nodes
+    PhaseWork,        // Work hooks of the items
+    PhaseClear,       // Resetting buffers for the next cycle
+    NumCyclePhases
+};
+
+inline const char* cycle_phase_name(int phase) {
+    static const char* names[NumCyclePhases] = {
+        "barrier", "size_rget", "buffer_rget", "local_recv", "remote_recv", "work", "clear"
+    };
+    return names[phase];
+}
+
+struct CycleTiming {
+    unsigned int cycle = 0;
+    double phase_seconds[NumCyclePhases] = {};
+    double total_seconds = 0;
+    // Items held by the rank at the end of the cycle
+    std::size_t items = 0;
+
+    inline double receive_seconds() const {
+        return phase_seconds[PhaseSizeRget] + phase_seconds[PhaseBufferRget]
+             + phase_seconds[PhaseLocalRecv] + phase_seconds[PhaseRemoteRecv];
+    }
+};
+
+/**
+ * Time spent per phase in the last PHASE_TIMINGS_CYCLES cycles.
+ * Phases are measured as laps: lap(phase) charges the time since the previous lap to phase.
+ */
+class PhaseTimings {
+    public:
+    using Clock = std::chrono::steady_clock;
+
+    bool enabled = false;
+    std::vector<CycleTiming> records;
+    std::size_t next_record = 0;
+    std::size_t num_records = 0;
+
+    void enable(std::size_t capacity = PHASE_TIMINGS_CYCLES) {
+        enabled = true;
+        records.assign(capacity, CycleTiming());
+        next_record = 0;
+        num_records = 0;
+    }
+
+    inline void begin_cycle(unsigned int cycle) {
+        if (!enabled) {
+            return;
+        }
+        current = CycleTiming();
+        current.cycle = cycle;
+        cycle_start = Clock::now();
+        last_lap = cycle_start;
+    }
+
+    inline void lap(CyclePhase phase) {
+        if (!enabled) {
+            return;
+        }
+        auto now = Clock::now();
+        current.phase_seconds[phase] += std::chrono::duration<double>(now - last_lap).count();
+        last_lap = now;
+    }
+
+    inline void end_cycle(std::size_t items = 0) {
+        if (!enabled || records.empty()) {
+            return;
+        }
+        current.items = items;
+        current.total_seconds = std::chrono::duration<double>(Clock::now() - cycle_start).count();
+        records[next_record] = current;
+        next_record = (next_record + 1) % records.size();
+        if (num_records < records.size()) {
+            num_records++;
+        }
+    }
+
+    /**
+     * Recorded cycles, oldest first
+     */
+    std::vector<CycleTiming> get_records() const {
+        std::vector<CycleTiming> ordered;
+        ordered.reserve(num_records);
+        std::size_t first = (next_record + records.size() - num_records) % (records.empty() ? 1 : records.size());
+        for (std::size_t i = 0; i < num_records; i++) {
+            ordered.push_back(records[(first + i) % records.size()]);
+        }
+        return ordered;
+    }
+
+    void write_csv(std::ostream& out, int rank) const {
+        out << "rank,cycle";
+        for (int p = 0; p < NumCyclePhases; p++) {
+            out << "," << cycle_phase_name(p);
+        }
+        out << ",total,items\n";
+
+        for (auto& record : get_records()) {
+            out << rank << "," << record.cycle;
+            for (int p = 0; p < NumCyclePhases; p++) {
+                out << "," << record.phase_seconds[p];
+            }
+            out << "," << record.total_seconds << "," << record.items << "\n";
+        }
+    }
+
+    void write_json(std::ostream& out, int rank) const {
+        out << "{\"rank\": " << rank << ", \"cycles\": [";
+        bool first = true;
+        for (auto& record : get_records()) {
+            out << (first ? "\n" : ",\n") << "  {\"cycle\": " << record.cycle;
+            for (int p = 0; p < NumCyclePhases; p++) {
+                out << ", \"" << cycle_phase_name(p) << "\": " << record.phase_seconds[p];
+            }
+            out << ", \"total\": " << record.total_seconds << ", \"items\": " << record.items << "}";
+            first = false;
+        }
+        out << "\n]}\n";
+    }
+
+    private:
+    CycleTiming current;
+    Clock::time_point cycle_start;
+    Clock::time_point last_lap;
+};
+
+/**
+ * Load balance of one cycle across ranks. Imbalances are max / mean over ranks, 1 is perfectly balanced.
+ */
+struct CycleLoad {
+    unsigned int cycle = 0;
+    double work_imbalance = 1;
+    // Receive covers fetching and delivering messages (all receive phases)
+    double receive_imbalance = 1;
+    double items_imbalance = 1;
+    // Rank with the most work and receive time, which the others wait for at the barrier
+    int slowest_rank = 0;
+    // Barrier wait of each rank, in seconds
+    std::vector<double> barrier_seconds;
+};
+
+/**
+ * Load balance of the recorded cycles, on rank 0. A rank is a straggler if it is slow (work and receive time
+ * above a ratio of the mean) in a minimum fraction of the cycles.
+ */
+struct LoadReport {
+    std::vector<CycleLoad> cycles;
+    // Host of each rank
+    std::vector<std::string> hosts;
+    // Number of cycles each rank was slow in
+    std::vector<unsigned int> slow_cycles;
+    std::vector<int> stragglers;
+};
+
+// Values of a recorded cycle that load reports are built from: cycle, barrier, work and receive seconds, items
+const std::size_t LOAD_VALUES_PER_CYCLE = 5;
+
+inline void append_load_values(std::vector<double>& values, const CycleTiming& record) {
+    values.push_back(record.cycle);
+    values.push_back(record.phase_seconds[PhaseBarrier]);
+    values.push_back(record.phase_seconds[PhaseWork]);
+    values.push_back(record.receive_seconds());
+    values.push_back(record.items);
+}
+
+/**
+ * Load report from the load values of the recorded cycles of each rank (see append_load_values()). Only the
+ * cycles that all ranks recorded are reported. Hosts are left to the caller.
+ */
+inline LoadReport build_load_report(const std::vector<std::vector<double>>& values, double slow_ratio, double min_fraction) {
+    const std::size_t fields = LOAD_VALUES_PER_CYCLE;
+    const int ranks = (int) values.size();
+    LoadReport report;
+    report.slow_cycles.assign(ranks, 0);
+    if (ranks == 0) {
+        return report;
+    }
+
+    // All ranks recorded the same cycles, unless some were not recording
+    std::size_t num_cycles = values[0].size() / fields;
+    for (auto& rank_cycles : values) {
+        num_cycles = std::min(num_cycles, rank_cycles.size() / fields);
+    }
+
+    for (std::size_t c = 0; c < num_cycles; c++) {
+        CycleLoad load;
+        load.cycle = (unsigned int) values[0][c * fields];
+        double work_max = 0, work_sum = 0, recv_max = 0, recv_sum = 0, items_max = 0, items_sum = 0;
+        double busy_max = -1, busy_sum = 0;
+
+        for (int i = 0; i < ranks; i++) {
+            const double* v = &values[i][c * fields];
+            load.barrier_seconds.push_back(v[1]);
+            work_max = std::max(work_max, v[2]);
+            work_sum += v[2];
+            recv_max = std::max(recv_max, v[3]);
+            recv_sum += v[3];
+            items_max = std::max(items_max, v[4]);
+            items_sum += v[4];
+            busy_sum += v[2] + v[3];
+            if (v[2] + v[3] > busy_max) {
+                busy_max = v[2] + v[3];
+                load.slowest_rank = i;
+            }
+        }
+
+        load.work_imbalance = work_sum > 0 ? work_max / (work_sum / ranks) : 1;
+        load.receive_imbalance = recv_sum > 0 ? recv_max / (recv_sum / ranks) : 1;
+        load.items_imbalance = items_sum > 0 ? items_max / (items_sum / ranks) : 1;
+
+        double busy_mean = busy_sum / ranks;
+        for (int i = 0; i < ranks; i++) {
+            const double* v = &values[i][c * fields];
+            if (busy_mean > 0 && v[2] + v[3] > slow_ratio * busy_mean) {
+                report.slow_cycles[i]++;
+            }
+        }
+        report.cycles.push_back(load);
+    }
+
+    for (int i = 0; i < ranks; i++) {
+        if (num_cycles > 0 && report.slow_cycles[i] >= min_fraction * num_cycles) {
+            report.stragglers.push_back(i);
+        }
+    }
+    return report;
+}
+
+/**
+ * Messages and bytes this rank sent to each rank, in total and in the last cycle that communicated.
+ * Bytes are those the receiver reads, which differ from messages times their size when only values are sent.
+ * The rows of all ranks together form the P x P traffic matrix of the job.
+ */
+class TrafficMatrix {
+    public:
+    bool enabled = false;
+    std::vector<uint64_t> total_messages;
+    std::vector<uint64_t> cycle_messages;
+    std::vector<uint64_t> total_bytes;
+    std::vector<uint64_t> cycle_bytes;
+    // Counted since the last end_cycle()
+    std::vector<uint64_t> pending_messages;
+    std::vector<uint64_t> pending_bytes;
+
+    void enable(int ranks) {
+        enabled = true;
+        total_messages.assign(ranks, 0);
+        cycle_messages.assign(ranks, 0);
+        total_bytes.assign(ranks, 0);
+        cycle_bytes.assign(ranks, 0);
+        pending_messages.assign(ranks, 0);
+        pending_bytes.assign(ranks, 0);
+    }
+
+    inline void add(int dest_rank, std::size_t messages, std::size_t bytes) {
+        if (enabled) {
+            total_messages[dest_rank] += messages;
+            pending_messages[dest_rank] += messages;
+            total_bytes[dest_rank] += bytes;
+            pending_bytes[dest_rank] += bytes;
+        }
+    }
+
+    inline void end_cycle() {
+        if (enabled) {
+            cycle_messages.swap(pending_messages);
+            std::fill(pending_messages.begin(), pending_messages.end(), 0);
+            cycle_bytes.swap(pending_bytes);
+            std::fill(pending_bytes.begin(), pending_bytes.end(), 0);
+        }
+    }
+
+    /**
+     * Messages of each rank, then bytes of each rank, as one row of the matrix
+     */
+    std::vector<uint64_t> row(bool last_cycle) const {
+        const std::vector<uint64_t>& messages = last_cycle ? cycle_messages : total_messages;
+        const std::vector<uint64_t>& bytes = last_cycle ? cycle_bytes : total_bytes;
+        std::vector<uint64_t> values(messages);
+        values.insert(values.end(), bytes.begin(), bytes.end());
+        return values;
+    }
+
+    /**
+     * One line per pair of ranks, for a heatmap of src against dest
+     */
+    void write_csv(std::ostream& out, const std::vector<uint64_t>& messages, const std::vector<uint64_t>& bytes, int ranks) const {
+        out << "src,dest,messages,bytes\n";
+        for (int src = 0; src < ranks; src++) {
+            for (int dest = 0; dest < ranks; dest++) {
+                std::size_t at = (std::size_t) src * ranks + dest;
+                out << src << "," << dest << "," << messages[at] << "," << bytes[at] << "\n";
+            }
+        }
+    }
+};
+
+/**
+ * Path of the file for one rank: "timings.csv" becomes "timings.3.csv" on rank 3
+ */
+inline std::string rank_file_path(const std::string& path, int rank) {
+    std::size_t dot = path.rfind('.');
+    std::size_t slash = path.rfind('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return path + "." + std::to_string(rank);
+    }
+    return path.substr(0, dot) + "." + std::to_string(rank) + path.substr(dot);
+}
+
+inline bool is_json_path(const std::string& path) {
+    return path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+}
+
+}//end namespace
+
+#endif
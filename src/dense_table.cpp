@@ -0,0 +1,226 @@
+// Copyright 2019 Saddlebag Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DENSE_TABLE_CPP
+#define DENSE_TABLE_CPP
+
+#include <assert.h>
+#include <cstddef>
+#include <iostream>
+#include <type_traits>
+#include <vector>
+
+#include "table.cpp"
+
+/*
+ * Table for compact integer keys, which are used directly as array index.
+ *
+ * Keys lie in [key_begin, key_end). Under MODULO_HASH each rank owns every P-th
+ * key, so (key - key_begin) / P is a dense local slot. Lookups do no hashing or
+ * probing, and memory is proportional to the share of the key range a rank owns.
+ * Without a range, keys start at 0 and the array grows with the largest key.
+ */
+
+namespace saddlebags
+{
+
+template <typename TableKey_T, typename ItemKey_T, typename Msg_T, typename ItemType>
+class DenseTableContainer : public TableContainer<TableKey_T, ItemKey_T, Msg_T, ItemType> {
+    public:
+    static_assert(std::is_integral<ItemKey_T>::value, "Dense tables need integer item keys");
+
+    std::vector<ItemType*> dense_items;
+    std::size_t num_items = 0;
+    std::size_t stride = 1;
+    ItemKey_T key_begin = 0;
+    ItemKey_T key_end = 0;
+    bool bounded = false;
+
+    using TableContainer<TableKey_T, ItemKey_T, Msg_T, ItemType>::apply_push_to_item;
+
+    ~DenseTableContainer() {
+        destroy_items();
+    }
+
+    /*
+     * Keys in [begin, end), of which this rank owns every stride-th. The slots are allocated now.
+     * An empty range leaves the table unbounded, for keys from 0 up.
+     * With a stride, the range can not start below 0: negative keys wrap around in the partitioning, so the
+     * keys of a rank are no longer stride apart and two of them would share a slot. Such a range is rejected.
+     */
+    bool set_range(ItemKey_T begin, ItemKey_T end, std::size_t key_stride) {
+        if (key_stride > 1 && begin < end && begin < ItemKey_T()) {
+            std::cout << "[Rank " << upcxx::rank_me() << "]"
+                      << " Error: Dense table " << (int) this->myTableKey << " can not start at negative key " << begin
+                      << " on more than one rank." << std::endl;
+            return false;
+        }
+        stride = key_stride;
+        bounded = begin < end;
+        key_begin = bounded ? begin : 0;
+        key_end = bounded ? end : 0;
+        if (bounded) {
+            dense_items.assign(((std::size_t) (key_end - key_begin) + stride - 1) / stride, nullptr);
+        }
+        return true;
+    }
+
+    inline bool in_range(ItemKey_T key) const {
+        return key >= key_begin && (!bounded || key < key_end);
+    }
+
+    inline std::size_t get_slot(ItemKey_T key) const {
+        return (std::size_t) (key - key_begin) / stride;
+    }
+
+    /*
+     *
+     */
+    ItemType* find_item(ItemKey_T key) override {
+        if (!in_range(key)) {
+            return nullptr;
+        }
+        std::size_t slot = get_slot(key);
+        return slot < dense_items.size() ? dense_items[slot] : nullptr;
+    }
+
+    /*
+     * Create the item for a new key. Keys outside the range of the table are an error, and are not added.
+     */
+    ItemType* add_new_item(ItemKey_T key) override {
+        if (!in_range(key)) {
+            std::cout << "[Rank " << upcxx::rank_me() << "]"
+                      << " Error: Item " << key << " is outside of the key range of dense table " << (int) this->myTableKey << "."
+                      << std::endl;
+            return nullptr;
+        }
+
+        std::size_t slot = get_slot(key);
+        if (slot >= dense_items.size()) {
+            dense_items.resize(slot + 1, nullptr);
+        }
+        // Each key of this rank has its own slot, set_range() rejects ranges where keys would share one
+        assert(dense_items[slot] == nullptr);
+
+        auto newobj = this->create_new_item(key);
+        dense_items[slot] = newobj;
+        num_items++;
+        return newobj;
+    }
+
+    /*
+     *
+     */
+    void add_new_items(const std::vector<ItemKey_T>& keys) override {
+        for (auto key : keys) {
+            add_new_item(key);
+        }
+    }
+
+    /*
+     *
+     */
+    void reserve_items(std::size_t n) override {
+        if (!bounded) {
+            dense_items.reserve(n);
+        }
+        this->work_items.reserve(n);
+    }
+
+    /*
+     *
+     */
+    bool remove_item(ItemKey_T key) override {
+        if (this->in_work) {
+            return this->defer_removal(key);
+        }
+        auto obj = find_item(key);
+        if (obj == nullptr) {
+            return false;
+        }
+
+        dense_items[get_slot(key)] = nullptr;
+        num_items--;
+        this->release_item(obj);
+        return true;
+    }
+
+    /*
+     * Items live in dense_items, so get_items() returns a copy
+     */
+    bool items_in_map() override {
+        return false;
+    }
+
+    /**
+     *
+     * @param msg
+     * @param is_create
+     * @return
+     */
+    int apply_push_to_item(Message<TableKey_T, ItemKey_T, Msg_T> const& msg, bool is_create) override {
+        const int CREATED_NEW_LOCAL = 100;
+        const int FOUND_EXISTING_LOCAL = 300;
+        const int IGNORED_NEW_REMOTE = 400;
+        const int IGNORED_NEW_LOCAL = 500;
+
+        // This check not necessary
+        if ((int) this->worker->get_partition(this->myTableKey, msg.dest_item) != upcxx::rank_me()) {
+            return IGNORED_NEW_REMOTE;
+        }
+
+        auto obj = find_item(msg.dest_item);
+        if (obj != nullptr) {
+            this->push_to_item(obj, msg.value);
+            return FOUND_EXISTING_LOCAL;
+        }
+
+        if (is_create && in_range(msg.dest_item)) {
+            obj = add_new_item(msg.dest_item);
+            this->push_to_item(obj, msg.value);
+            return CREATED_NEW_LOCAL;
+        }
+
+        return IGNORED_NEW_LOCAL;
+    }
+
+    /*
+     * Dense tables have no hash map, the array of items takes its place
+     */
+    void account_memory(TableMemory& memory) override {
+        TableContainer<TableKey_T, ItemKey_T, Msg_T, ItemType>::account_memory(memory);
+        memory.map_slots = dense_items.size();
+        memory.map_occupied = num_items;
+        memory.map_bytes += dense_items.capacity() * sizeof(ItemType*);
+    }
+
+    /*
+     * Dense tables are already compact, there is nothing to freeze
+     */
+    void freeze() override {
+    }
+
+    /*
+     *
+     */
+    void destroy_items() override {
+        dense_items.clear();
+        num_items = 0;
+        TableContainer<TableKey_T, ItemKey_T, Msg_T, ItemType>::destroy_items();
+    }
+};
+
+}//end namespace
+
+#endif
@@ -37,12 +37,13 @@ Worker<key_T, value_T, message_T>* create_worker(unsigned int size = INITIAL_RES
 }
 
 /*
- * Destroy worker
+ * Destroy worker, writing its timings and trace if paths were given. Must be called by all ranks,
+ * before finalize(). Returns nullptr, for resetting the pointer.
  */
 template<class key_T, class value_T, class message_T>
 Worker<key_T, value_T, message_T>* destroy_worker(Worker<key_T, value_T, message_T>* w) {
-    // TODO: Delete Worker object and all its contents
-    // delete w;
+    delete w;
+    return nullptr;
 }
 
 } //end namespace
@@ -0,0 +1,111 @@
+// Copyright 2019 Saddlebag Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef FROZEN_MAP_CPP
+#define FROZEN_MAP_CPP
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+//Immutable map for key sets that no longer change.
+//Keys are sorted and stored in Eytzinger (BFS) order, so that a lookup is a
+//branch-free walk down an implicit binary tree whose top levels stay in cache.
+//Slot 0 is unused, the tree root is slot 1.
+
+namespace saddlebags
+{
+
+template<typename keyT, typename valueT>
+class Frozen_Map {
+    public:
+
+    std::vector<keyT> keys;
+    std::vector<valueT> values;
+    std::size_t num_items = 0;
+
+    /**
+     * Replace the contents of the map with the given pairs. Keys must be unique.
+     */
+    void build(std::vector<std::pair<keyT, valueT>>& pairs)
+    {
+        std::sort(pairs.begin(), pairs.end(),
+            [](const std::pair<keyT, valueT>& a, const std::pair<keyT, valueT>& b) {
+                return a.first < b.first;
+            });
+
+        num_items = pairs.size();
+        keys.assign(num_items + 1, keyT());
+        values.assign(num_items + 1, valueT());
+        keys.shrink_to_fit();
+        values.shrink_to_fit();
+        fill(pairs, 0, 1);
+    }
+
+    /**
+     * Slot of key, or 0 if the key was not found
+     */
+    std::size_t find_location(const keyT& key) const
+    {
+        std::size_t k = 1;
+        while(k <= num_items)
+        {
+            k = 2 * k + (keys[k] < key);
+        }
+        //Undo the right turns taken after the last left turn, which lands on the lower bound
+        k >>= __builtin_ffsll(~(unsigned long long) k);
+
+        if(k != 0 && keys[k] == key)
+        {
+            return k;
+        }
+        return 0;
+    }
+
+    void clear()
+    {
+        keys.clear();
+        values.clear();
+        keys.shrink_to_fit();
+        values.shrink_to_fit();
+        num_items = 0;
+    }
+
+    std::size_t bytes() const
+    {
+        return keys.capacity() * sizeof(keyT) + values.capacity() * sizeof(valueT);
+    }
+
+    private:
+
+    /**
+     * In-order walk of the implicit tree, placing the next sorted pair at each node
+     */
+    std::size_t fill(const std::vector<std::pair<keyT, valueT>>& pairs, std::size_t i, std::size_t k)
+    {
+        if(k <= num_items)
+        {
+            i = fill(pairs, i, 2 * k);
+            keys[k] = pairs[i].first;
+            values[k] = pairs[i].second;
+            i = fill(pairs, i + 1, 2 * k + 1);
+        }
+        return i;
+    }
+};
+
+} //end namespace
+
+#endif
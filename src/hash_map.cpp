@@ -12,25 +12,40 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
 #include "hashf.cpp"
 
-//Hash map implementation
+//Hash map implementation, with linear probing.
+//Define ROBIN_SWAPPING for Robin Hood swapping, which keeps each cluster ordered by home bucket
+//and lets lookups of missing keys stop early. erase() shifts entries back without tombstones either way.
+//Stored hashes have their top bit set, so that a hash of 0 marks an empty entry without a separate flag.
 
 //#define ROBIN_SWAPPING
 
 namespace saddlebags
 {
 
-int bit_modulo(int x, int N) {
-    return (x & (N-1));
+inline std::size_t bit_modulo(uint64_t x, std::size_t N) {
+    return (std::size_t) (x & (N-1));
 }
 
+const uint64_t OCCUPIED_HASH_BIT = (uint64_t) 1 << 63;
+
 template<typename keyT, typename valueT>
 class Entry {
     public:
-    int hash = -1;
+    uint64_t hash = 0;
     keyT first;
     valueT second;
+
+    inline bool occupied() const {
+        return hash != 0;
+    }
 };
 
 template<typename keyT, typename valueT> class RobinIterator;
@@ -41,25 +56,26 @@ class Robin_Map {
 
     using iterator = RobinIterator<keyT, valueT>;
 
-    int size = 1024;
+    std::size_t size = 1024;
     Entry<keyT, valueT>* entries;
-    const float load_factor = 0.5;
-    int num_items = 0;
+    const double load_factor = 0.5;
+    std::size_t num_items = 0;
 
     Robin_Map() {
         entries = new Entry<keyT, valueT>[size];
-        for(int i = 0; i < size; i++)
-        {
-            Entry<keyT, valueT> tmp;
-            tmp.hash = -1;
-            entries[i] = tmp;
-        }
     }
 
+    ~Robin_Map() {
+        delete[] entries;
+    }
+
+    Robin_Map(const Robin_Map&) = delete;
+    Robin_Map& operator=(const Robin_Map&) = delete;
+
     iterator begin(){
-        for(int i = 0; i < size; i++)
+        for(std::size_t i = 0; i < size; i++)
         {
-            if(entries[i].hash != -1)
+            if(entries[i].occupied())
             {
                 return iterator(*this, i);
             }
@@ -71,80 +87,47 @@ class Robin_Map {
         return iterator(*this, size);
     }
 
-    int get_offset(Entry<keyT, valueT> entry, int location)
+    std::size_t get_offset(const Entry<keyT, valueT>& entry, std::size_t location)
     {
-        int desired_loc = bit_modulo(entry.hash, size);
+        std::size_t desired_loc = bit_modulo(entry.hash, size);
 
         if(location >= desired_loc)
             return location - desired_loc;
         return location + (size-desired_loc);
     }
 
-    int get_offset(Entry<keyT, valueT> entry, int location, int new_size)
+    std::size_t get_offset(const Entry<keyT, valueT>& entry, std::size_t location, std::size_t new_size)
     {
-        int desired_loc = bit_modulo(entry.hash, new_size);
+        std::size_t desired_loc = bit_modulo(entry.hash, new_size);
 
         if(location >= desired_loc)
             return location - desired_loc;
         return location + (new_size-desired_loc);
     }
 
-    bool core_insert_with_hash(keyT key, valueT val, int hashed)
+    bool core_insert_with_hash(keyT key, valueT val, uint64_t hashed)
     {
-        int location = bit_modulo(hashed, size);
-
-        keyT key_to_place = key;
-        valueT val_to_place = val;
-        #ifdef OFFSET_LIMIT
-        #endif
-        int i = 0;
-        while(true)
-        {
-            location = bit_modulo((location+i), size);
-
-            if(entries[location].hash == -1)
-            {
-                entries[location].first = key_to_place;
-                entries[location].second = val_to_place;
-                entries[location].hash = hashed;
-                return true;
-            }
-            #ifdef ROBIN_SWAPPING
-            int offset = get_offset(entries[location], location);
-            if(offset < i)
-            {
-                //Robin Hood swap
-                std::swap(entries[location].first, key_to_place);
-                std::swap(entries[location].second, val_to_place);
-                std::swap(entries[location].hash, hashed);
-                i = offset;
-            }
-            #endif
-            i++;
-        }
-        return false;
+        return insert_new_array(key, val, hashed, entries, size);
     }
 
 
     bool core_insert(keyT key, valueT val)
     {
-        int hashed = hashf(key);
+        uint64_t hashed = hashf(key);
         return core_insert_with_hash(key,val,hashed);
     }
 
-    bool insert_new_array(keyT key, valueT val, int hashed, Entry<keyT, valueT>* entry_array, int new_size)
+    bool insert_new_array(keyT key, valueT val, uint64_t hashed, Entry<keyT, valueT>* entry_array, std::size_t new_size)
     {
-        
-        int location = bit_modulo(hashed, new_size);
+        hashed |= OCCUPIED_HASH_BIT;
+        std::size_t location = bit_modulo(hashed, new_size);
 
         keyT key_to_place = key;
         valueT val_to_place = val;
-        int i = 0;
+        std::size_t i = 0;
         while(true)
         {
-            location = bit_modulo((location+i), new_size);
-
-            if(entry_array[location].hash == -1)
+            if(!entry_array[location].occupied())
             {
                 entry_array[location].first = key_to_place;
                 entry_array[location].second = val_to_place;
@@ -152,7 +135,7 @@ class Robin_Map {
                 return true;
             }
             #ifdef ROBIN_SWAPPING
-            int offset = get_offset(entry_array[location], location, new_size);
+            std::size_t offset = get_offset(entry_array[location], location, new_size);
             if(offset < i)
             {
                 //Robin Hood swap
@@ -162,6 +145,7 @@ class Robin_Map {
                 i = offset;
             }
             #endif
+            location = bit_modulo(location+1, new_size);
             i++;
         }
         return false;
@@ -169,7 +153,7 @@ class Robin_Map {
 
     bool above_load_factor()
     {
-        if(num_items > (float)size * load_factor)
+        if(num_items > (double)size * load_factor)
         {
             return true;
         }
@@ -178,29 +162,87 @@ class Robin_Map {
 
     iterator find(keyT key)
     {
-        int hashed = hashf(key);
-        int location = bit_modulo(hashed, size);
+        return iterator(*this, find_location(key));
+    }
+
+    /**
+     * Slot of key, or size if the key was not found
+     */
+    std::size_t find_location(keyT key)
+    {
+        uint64_t hashed = hashf(key) | OCCUPIED_HASH_BIT;
+        std::size_t location = bit_modulo(hashed, size);
 
-        int i = 0;
+        std::size_t i = 0;
         while(true)
         {
-            location = bit_modulo((location+i), size);
-
+            if(!entries[location].occupied())
+            {
+                return size;
+            }
 
-            if(entries[location].hash == -1)
+            #ifdef ROBIN_SWAPPING
+            //Entries are ordered by home bucket, so the key cannot be further along
+            if(get_offset(entries[location], location) < i)
             {
-                return end();
+                return size;
             }
+            #endif
 
-            if(entries[location].first == key)
+            if(entries[location].hash == hashed && entries[location].first == key)
             {
-                return iterator(*this, location);
+                return location;
             }
 
+            location = bit_modulo(location+1, size);
             i++;
         }
 
-        return end();
+        return size;
+    }
+
+    /**
+     * Remove key from the map. Returns false if the key was not found.
+     */
+    bool erase(keyT key)
+    {
+        std::size_t location = find_location(key);
+        if(location == size)
+        {
+            return false;
+        }
+        erase_at(location);
+        return true;
+    }
+
+    void erase_at(std::size_t location)
+    {
+        std::size_t next = bit_modulo(location+1, size);
+        #ifdef ROBIN_SWAPPING
+        //Backward shift: pull the rest of the cluster one slot closer to home
+        while(entries[next].occupied() && get_offset(entries[next], next) > 0)
+        {
+            entries[location] = entries[next];
+            location = next;
+            next = bit_modulo(location+1, size);
+        }
+        #else
+        //Without Robin Hood ordering, only move entries whose home is not between the hole and their slot
+        while(entries[next].occupied())
+        {
+            std::size_t home = bit_modulo(entries[next].hash, size);
+            bool reachable = (location <= next) ? (location < home && home <= next)
+                                                : (location < home || home <= next);
+            if(!reachable)
+            {
+                entries[location] = entries[next];
+                location = next;
+            }
+            next = bit_modulo(next+1, size);
+        }
+        #endif
+        entries[location].hash = 0;
+        num_items -= 1;
     }
 
 
@@ -219,7 +261,7 @@ class Robin_Map {
 
     }
 
-    void insert(keyT key, valueT val, int hashed)
+    void insert(keyT key, valueT val, uint64_t hashed)
     {
         if(above_load_factor())
         {
@@ -238,21 +280,27 @@ class Robin_Map {
 
 
 
-    void expand(int new_size)
+    std::size_t bytes() const
     {
-        Entry<keyT, valueT>* new_entries = new Entry<keyT, valueT>[new_size];
-
+        return size * sizeof(Entry<keyT, valueT>);
+    }
 
-        for(int i = 0; i < new_size; i++)
+    void clear()
+    {
+        for(std::size_t i = 0; i < size; i++)
         {
-            Entry<keyT, valueT> tmp;
-            tmp.hash = -1;
-            new_entries[i] = tmp;
+            entries[i].hash = 0;
         }
-        
-        for(int i = 0; i<size; i++)
+        num_items = 0;
+    }
+
+    void expand(std::size_t new_size)
+    {
+        Entry<keyT, valueT>* new_entries = new Entry<keyT, valueT>[new_size];
+
+        for(std::size_t i = 0; i<size; i++)
         {
-            if(entries[i].hash != -1)
+            if(entries[i].occupied())
             {
 
                 insert_new_array(entries[i].first, entries[i].second, entries[i].hash, new_entries, new_size);
@@ -263,6 +311,50 @@ class Robin_Map {
         size = new_size;
     }
 
+    /**
+     * Grow the map once, so that n items fit without further expansion
+     */
+    void reserve(std::size_t n)
+    {
+        std::size_t new_size = size;
+        while((double)new_size * load_factor < n)
+        {
+            new_size *= 2;
+        }
+
+        if(new_size > size)
+        {
+            expand(new_size);
+        }
+    }
+
+    /**
+     * Insert n new keys (not already in the map), growing the map only once.
+     * Keys are placed in order of their home bucket, so that the entries
+     * array is filled front to back instead of at random.
+     */
+    void build(const keyT* keys, const valueT* vals, std::size_t n)
+    {
+        reserve(num_items + n);
+
+        std::vector<std::pair<uint64_t, std::size_t>> homes;
+        homes.reserve(n);
+        for(std::size_t i = 0; i < n; i++)
+        {
+            homes.emplace_back(hashf(keys[i]), i);
+        }
+        std::sort(homes.begin(), homes.end(),
+            [this](const std::pair<uint64_t, std::size_t>& a, const std::pair<uint64_t, std::size_t>& b) {
+                return bit_modulo(a.first, size) < bit_modulo(b.first, size);
+            });
+
+        for(auto home : homes)
+        {
+            core_insert_with_hash(keys[home.second], vals[home.second], home.first);
+            num_items += 1;
+        }
+    }
+
 };
 
 template<typename keyT, typename valueT>
@@ -275,22 +367,22 @@ class RobinIterator
     using reference = valueT&;
     using iterator = RobinIterator<keyT, valueT>;
 
-    int current_loc = 0;
     Robin_Map<keyT, valueT> &my_map;
+    std::size_t current_loc = 0;
     keyT first;
     valueT second;
 
     RobinIterator(Robin_Map<keyT, valueT>& map) : my_map(map), current_loc(0)
     {}
 
-    RobinIterator(Robin_Map<keyT, valueT>& map, int start_loc) : my_map(map), current_loc(start_loc)
+    RobinIterator(Robin_Map<keyT, valueT>& map, std::size_t start_loc) : my_map(map), current_loc(start_loc)
     {}
 
     iterator & operator++()
     {
         do {
             current_loc+=1;
-        } while(my_map.entries[current_loc].hash == -1 && current_loc != my_map.size);
+        } while(current_loc != my_map.size && !my_map.entries[current_loc].occupied());
         return *this;
     }
 
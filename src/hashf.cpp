@@ -15,37 +15,33 @@
 #ifndef HASHF_CPP
 #define HASHF_CPP
 
+#include <cstdint>
 #include <string>
+#include <type_traits>
 #include <vector>
 #include "city.h"
 
-//This file contains hash functions, based on CityHash 
+//This file contains hash functions, based on CityHash
+//All of them return the full 64-bit hash
 
-int c_abs(int input)
+uint64_t hashf(std::string key)
 {
-	if(input >= 0)
-		return input;
-	return input*-1;
+	return CityHash64((const char*)key.c_str(), (size_t)key.size());
 }
 
-int hashf(std::string key)
+template<typename T>
+typename std::enable_if<std::is_integral<T>::value, uint64_t>::type hashf(T key)
 {
-	return c_abs(CityHash32((const char*)key.c_str(), (size_t)key.size()));
+	return CityHash64((const char*)(&key), sizeof(key));
 }
 
-
-int hashf(int key)
-{
-	return c_abs(CityHash32((const char*)(&key), sizeof(key)));
-}
-
-int hashf(std::pair<int, int> key)
+uint64_t hashf(std::pair<int, int> key)
 {
 	int tmp = key.first + key.second;
-	return c_abs(CityHash32((const char*)(&tmp), sizeof(tmp)));
+	return CityHash64((const char*)(&tmp), sizeof(tmp));
 }
 
-int hashf(std::vector<std::string> key)
+uint64_t hashf(std::vector<std::string> key)
 {
 	std::string tmp = "";
 
@@ -1,6 +1,9 @@
 #ifndef DATAOBJECT_H
 #define DATAOBJECT_H
 
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
 #include <vector>
 #include <iostream>
 #include "message.cpp"
@@ -12,32 +15,36 @@ namespace saddlebags
 
 template<typename TableKey_T, typename ItemKey_T, typename Msg_T> class Worker;
 
+// Position of an Item in the packed item list of its table. 32 bits, unless a table can hold more Items on one rank.
+using ItemSlot = std::conditional<LARGE_TABLES, uint64_t, uint32_t>::type;
+
+/*
+ * Common type of all Items. Tables and the Worker refer to Items of any kind through this class, and call the
+ * hooks through the table, which knows the Item type.
+ */
+template<class TableKey_T, class ItemKey_T, class Msg_T>
+class ItemBase {
+};
+
+/*
+ * Where an Item lives: its Worker, table, key and slot. The messaging API of Items is implemented here.
+ * Items with the full header (Item, StaticItem) carry these fields themselves, SlimItems get their context
+ * from the table, as argument of their hooks.
+ */
 template<class TableKey_T, class ItemKey_T, class Msg_T>
-class Item {
+class ItemContext {
     public:
-    Msg_T value;
-    TableKey_T myTableKey;
+    Worker<TableKey_T, ItemKey_T, Msg_T> *worker;
+    std::size_t table_slot;
     ItemKey_T myItemKey;
-    Worker<TableKey_T, ItemKey_T, Msg_T> *worker = nullptr;
-    int next_seqnum = 0;
-
-    /**
-     *
-     */
-    Item() {
-    }
-
-    Item (TableKey_T myTableKey, ItemKey_T myItemKey) {
-        this->myTableKey = myTableKey;
-        this->myItemKey = myItemKey;
-    }
+    TableKey_T myTableKey;
 
     /**
      *
      */
     void push(TableKey_T destTableKey = TableKey_T(),
         ItemKey_T destItemKey = ItemKey_T(),
-        Msg_T val = Msg_T()) {
+        Msg_T val = Msg_T()) const {
 
         Message<TableKey_T, ItemKey_T, Msg_T> msg;
         msg.dest_table = destTableKey;
@@ -59,10 +66,71 @@ class Item {
         }
     }
 
+    /**
+     * Push the same value to many Items of one table. Cheaper than calling push() for each key,
+     * as the keys are routed to their ranks in one pass.
+     */
+    void push_many(TableKey_T destTableKey, const std::vector<ItemKey_T>& destItemKeys, Msg_T val) const {
+        Message<TableKey_T, ItemKey_T, Msg_T> msg;
+        msg.dest_table = destTableKey;
+        msg.src_table = myTableKey;
+        msg.src_item = myItemKey;
+        msg.value = val;
+
+        assert(msg.src_table < this->worker->total_tables);
+        assert(msg.dest_table < this->worker->total_tables);
+        worker->enqueue_push_many(msg, destItemKeys.data(), nullptr, destItemKeys.size());
+    }
+
+    /**
+     * Push vals[i] to the Item destItemKeys[i] of one table, for all i
+     */
+    void push_many(TableKey_T destTableKey, const std::vector<ItemKey_T>& destItemKeys, const std::vector<Msg_T>& vals) const {
+        assert(destItemKeys.size() == vals.size());
+
+        Message<TableKey_T, ItemKey_T, Msg_T> msg;
+        msg.dest_table = destTableKey;
+        msg.src_table = myTableKey;
+        msg.src_item = myItemKey;
+
+        assert(msg.src_table < this->worker->total_tables);
+        assert(msg.dest_table < this->worker->total_tables);
+        worker->enqueue_push_many(msg, destItemKeys.data(), vals.data(), destItemKeys.size());
+    }
+
+    /**
+     * Run the work hooks of this Item in the next cycle, for tables with active scheduling
+     */
+    void activate() const {
+        worker->activate_item(myTableKey, table_slot);
+    }
+
+    /**
+     * Stop running the work hooks of this Item from the next cycle on, until a message arrives.
+     * Only has an effect for tables with vote to halt enabled.
+     */
+    void vote_to_halt() const {
+        worker->halt_item(myTableKey, table_slot);
+    }
+
+    /**
+     * Remove an Item from a table. The owner of the Item deletes it when the request is received, in the next cycle.
+     */
+    void remove(TableKey_T destTableKey, ItemKey_T destItemKey) const {
+        worker->enqueue_remove_request(destTableKey, destItemKey);
+    }
+
+    /**
+     * Remove this Item, in the next cycle
+     */
+    void remove() const {
+        remove(myTableKey, myItemKey);
+    }
+
     /**
      *
      */
-    void broadcast(TableKey_T destTableKey, ItemKey_T destItemKey, Msg_T val) {
+    void broadcast(TableKey_T destTableKey, ItemKey_T destItemKey, Msg_T val) const {
         Message<TableKey_T, ItemKey_T, Msg_T> msg;
         msg.dest_table = destTableKey;
         msg.dest_item = destItemKey;
@@ -74,6 +142,92 @@ class Item {
         // worker->tables[myTableKey]->broadcast_value = val;
         // worker->tables[myTableKey]->broadcast_origin_item = myItemKey;
     }
+};
+
+/*
+ * Fields and messaging of an Item, shared by Item (virtual hooks) and StaticItem (hooks bound at compile time)
+ */
+template<class TableKey_T, class ItemKey_T, class Msg_T>
+class ItemHeader : public ItemBase<TableKey_T, ItemKey_T, Msg_T> {
+    public:
+    // Items with this header keep their Worker, table and key themselves
+    static constexpr bool slim_header = false;
+
+    // Header fields are ordered by size, so that little padding is needed between them
+    Worker<TableKey_T, ItemKey_T, Msg_T> *worker = nullptr;
+    // Position of this Item in the packed item list of its table
+    ItemSlot table_slot = 0;
+    Msg_T value;
+    ItemKey_T myItemKey;
+    TableKey_T myTableKey;
+
+    /**
+     *
+     */
+    ItemHeader() {
+    }
+
+    ItemHeader (TableKey_T myTableKey, ItemKey_T myItemKey) {
+        this->myTableKey = myTableKey;
+        this->myItemKey = myItemKey;
+    }
+
+    /**
+     * Worker, table, key and slot of this Item
+     */
+    ItemContext<TableKey_T, ItemKey_T, Msg_T> context() const {
+        return ItemContext<TableKey_T, ItemKey_T, Msg_T>{worker, table_slot, myItemKey, myTableKey};
+    }
+
+    void push(TableKey_T destTableKey = TableKey_T(),
+        ItemKey_T destItemKey = ItemKey_T(),
+        Msg_T val = Msg_T()) {
+        context().push(destTableKey, destItemKey, val);
+    }
+
+    void push_many(TableKey_T destTableKey, const std::vector<ItemKey_T>& destItemKeys, Msg_T val) {
+        context().push_many(destTableKey, destItemKeys, val);
+    }
+
+    void push_many(TableKey_T destTableKey, const std::vector<ItemKey_T>& destItemKeys, const std::vector<Msg_T>& vals) {
+        context().push_many(destTableKey, destItemKeys, vals);
+    }
+
+    void activate() {
+        context().activate();
+    }
+
+    void vote_to_halt() {
+        context().vote_to_halt();
+    }
+
+    void remove(TableKey_T destTableKey, ItemKey_T destItemKey) {
+        context().remove(destTableKey, destItemKey);
+    }
+
+    void remove() {
+        context().remove();
+    }
+
+    void broadcast(TableKey_T destTableKey, ItemKey_T destItemKey, Msg_T val) {
+        context().broadcast(destTableKey, destItemKey, val);
+    }
+};
+
+template<class TableKey_T, class ItemKey_T, class Msg_T>
+class Item : public ItemHeader<TableKey_T, ItemKey_T, Msg_T> {
+    public:
+    // Class which declares the default hooks
+    using HookBase = Item;
+
+    /**
+     *
+     */
+    Item() {
+    }
+
+    Item (TableKey_T myTableKey, ItemKey_T myItemKey) : ItemHeader<TableKey_T, ItemKey_T, Msg_T>(myTableKey, myItemKey) {
+    }
 
     /**
      * Called when the object is created AND when the table container attempts to create an identical object
@@ -93,15 +247,41 @@ class Item {
     virtual void on_push_recv(Msg_T val) {
     }
 
+    /*
+     * Called once per cycle with all n values pushed to this object, from all ranks.
+     * Items that override it receive their pushes only this way, grouped after all buffers of the cycle are in.
+     */
+    virtual void on_push_batch(const Msg_T* vals, std::size_t n) {
+        for (std::size_t i = 0; i < n; i++) {
+            on_push_recv(vals[i]);
+        }
+    }
+
+    /*
+     * Called when the object is removed from its table, before it is released
+     */
+    virtual void on_remove() {
+    }
+
     //Called when something is pulled from this object
     virtual Msg_T foreign_pull(int tag) {
-        return value;
+        return this->value;
     }
 
     //Called when a pull originating at this object completes
     virtual void returning_pull(Message<TableKey_T, ItemKey_T, Msg_T> const & returning_message) {
     }
 
+    //Priority for tables with priority scheduling, lower runs first (e.g. a tentative distance)
+    virtual double priority() {
+        return 0;
+    }
+
+    //Bytes held by this Item outside of its object (e.g. in containers), for memory accounting
+    virtual std::size_t memory_bytes() {
+        return 0;
+    }
+
     //Called once per cycle, after communication is received
     virtual void before_work() {
     }
@@ -114,5 +294,223 @@ class Item {
     virtual void finishing_work() {
     }
 };
+
+/*
+ * Item with the same hooks as Item, dispatched at compile time instead of through a vtable:
+ *
+ *   template<class Tk, class Ok, class Mt>
+ *   class Vertex : public saddlebags::StaticItem<Vertex<Tk, Ok, Mt>, Tk, Ok, Mt> { ... };
+ *
+ * Tables call the hooks on the derived type, so hooks that are not redefined compile away, and small ones
+ * are inlined into the work loop. The Items have no vtable pointer. Hooks are redefined without override,
+ * and are called on the derived type only, so calls through a StaticItem pointer reach the defaults.
+ */
+template<class Derived, class TableKey_T, class ItemKey_T, class Msg_T>
+class StaticItem : public ItemHeader<TableKey_T, ItemKey_T, Msg_T> {
+    public:
+    // Class which declares the default hooks
+    using HookBase = StaticItem;
+
+    void refresh() {
+    }
+
+    void on_create() {
+    }
+
+    void on_push_recv(Msg_T val) {
+    }
+
+    void on_push_batch(const Msg_T* vals, std::size_t n) {
+        for (std::size_t i = 0; i < n; i++) {
+            static_cast<Derived*>(this)->on_push_recv(vals[i]);
+        }
+    }
+
+    void on_remove() {
+    }
+
+    Msg_T foreign_pull(int tag) {
+        return this->value;
+    }
+
+    void returning_pull(Message<TableKey_T, ItemKey_T, Msg_T> const & returning_message) {
+    }
+
+    double priority() {
+        return 0;
+    }
+
+    std::size_t memory_bytes() {
+        return 0;
+    }
+
+    void before_work() {
+    }
+
+    void do_work() {
+    }
+
+    void finishing_work() {
+    }
+};
+
+/*
+ * Item with the smallest header: only its slot in the item list, 4 bytes, and no vtable pointer. For tables of
+ * many tiny Items, where the full header would outweigh the fields of the Items:
+ *
+ *   template<class Tk, class Ok, class Mt>
+ *   class Vertex : public saddlebags::SlimItem<Vertex<Tk, Ok, Mt>, Tk, Ok, Mt> {
+ *       void do_work(const typename Vertex::Context& context) { context.push(0, next, rank); }
+ *   };
+ *
+ * The key is stored only by the table, and the Worker and table are implicit. Hooks receive them as context,
+ * with the messaging API of Items (push(), vote_to_halt(), ...). Hooks are bound at compile time as for
+ * StaticItem. There is no value field, and foreign_pull() returns Msg_T() unless redefined.
+ */
+template<class Derived, class TableKey_T, class ItemKey_T, class Msg_T>
+class SlimItem : public ItemBase<TableKey_T, ItemKey_T, Msg_T> {
+    public:
+    // Class which declares the default hooks
+    using HookBase = SlimItem;
+    using Context = ItemContext<TableKey_T, ItemKey_T, Msg_T>;
+    // The table keeps the key of the Item, and passes a Context to its hooks
+    static constexpr bool slim_header = true;
+
+    // Position of this Item in the packed item list of its table
+    ItemSlot table_slot = 0;
+
+    void refresh(const Context& context) {
+    }
+
+    void on_create(const Context& context) {
+    }
+
+    void on_push_recv(const Context& context, Msg_T val) {
+    }
+
+    void on_push_batch(const Context& context, const Msg_T* vals, std::size_t n) {
+        for (std::size_t i = 0; i < n; i++) {
+            static_cast<Derived*>(this)->on_push_recv(context, vals[i]);
+        }
+    }
+
+    void on_remove(const Context& context) {
+    }
+
+    Msg_T foreign_pull(const Context& context, int tag) {
+        return Msg_T();
+    }
+
+    void returning_pull(const Context& context, Message<TableKey_T, ItemKey_T, Msg_T> const & returning_message) {
+    }
+
+    double priority() {
+        return 0;
+    }
+
+    std::size_t memory_bytes() {
+        return 0;
+    }
+
+    void before_work(const Context& context) {
+    }
+
+    void do_work(const Context& context) {
+    }
+
+    void finishing_work(const Context& context) {
+    }
+};
+
+/*
+ * Calls of the hooks that tables make. Items with the full header find their context in their own fields,
+ * SlimItems get it as argument.
+ */
+template<typename ItemType, bool Slim = ItemType::slim_header>
+struct ItemHooks {
+    template<typename Context>
+    static inline void create(ItemType* obj, const Context&) {
+        obj->on_create();
+        obj->refresh();
+    }
+
+    template<typename Context>
+    static inline void refresh(ItemType* obj, const Context&) {
+        obj->refresh();
+    }
+
+    template<typename Context, typename Msg_T>
+    static inline void push_recv(ItemType* obj, const Context&, Msg_T const& val) {
+        obj->on_push_recv(val);
+    }
+
+    template<typename Context, typename Msg_T>
+    static inline void push_batch(ItemType* obj, const Context&, const Msg_T* vals, std::size_t n) {
+        obj->on_push_batch(vals, n);
+    }
+
+    template<typename Context>
+    static inline void remove(ItemType* obj, const Context&) {
+        obj->on_remove();
+    }
+
+    template<typename Context>
+    static inline void work(ItemType* obj, const Context&) {
+        obj->before_work();
+        obj->do_work();
+        obj->finishing_work();
+    }
+};
+
+template<typename ItemType>
+struct ItemHooks<ItemType, true> {
+    template<typename Context>
+    static inline void create(ItemType* obj, const Context& context) {
+        obj->on_create(context);
+        obj->refresh(context);
+    }
+
+    template<typename Context>
+    static inline void refresh(ItemType* obj, const Context& context) {
+        obj->refresh(context);
+    }
+
+    template<typename Context, typename Msg_T>
+    static inline void push_recv(ItemType* obj, const Context& context, Msg_T const& val) {
+        obj->on_push_recv(context, val);
+    }
+
+    template<typename Context, typename Msg_T>
+    static inline void push_batch(ItemType* obj, const Context& context, const Msg_T* vals, std::size_t n) {
+        obj->on_push_batch(context, vals, n);
+    }
+
+    template<typename Context>
+    static inline void remove(ItemType* obj, const Context& context) {
+        obj->on_remove(context);
+    }
+
+    template<typename Context>
+    static inline void work(ItemType* obj, const Context& context) {
+        obj->before_work(context);
+        obj->do_work(context);
+        obj->finishing_work(context);
+    }
+};
+
+/*
+ * True for item types that override on_push_batch()
+ */
+template<typename ItemType, typename TableKey_T, typename ItemKey_T, typename Msg_T>
+struct has_push_batch : std::integral_constant<bool,
+    !std::is_same<decltype(&ItemType::on_push_batch), decltype(&ItemType::HookBase::on_push_batch)>::value> {};
+
+/*
+ * True for item types that override memory_bytes()
+ */
+template<typename ItemType>
+struct has_memory_bytes : std::integral_constant<bool,
+    !std::is_same<decltype(&ItemType::memory_bytes), decltype(&ItemType::HookBase::memory_bytes)>::value> {};
+
 }//end namespace
 #endif
@@ -0,0 +1,139 @@
+// Copyright 2019 Saddlebag Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ITEM_ALLOCATOR_CPP
+#define ITEM_ALLOCATOR_CPP
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "utils.hpp"
+
+//Slab allocator for items of a single table
+
+namespace saddlebags
+{
+
+template<typename ItemType>
+class ItemAllocator {
+    public:
+
+    std::size_t slab_size = SLAB_ITEMS_PER_CHUNK;
+    std::vector<ItemType*> slabs;
+    std::vector<ItemType*> free_list;
+    std::size_t slab_used = 0;
+    std::size_t num_items = 0;
+
+    ItemAllocator() {
+    }
+
+    ItemAllocator(std::size_t items_per_slab) : slab_size(items_per_slab) {
+    }
+
+    ~ItemAllocator() {
+        release();
+    }
+
+    ItemAllocator(const ItemAllocator&) = delete;
+    ItemAllocator& operator=(const ItemAllocator&) = delete;
+
+    /**
+     * Construct a new item from args, reusing the space of a removed item if there is one.
+     * Otherwise items are placed in the current slab, in insertion order, and
+     * a new slab is only requested once the current one is full.
+     */
+    template<typename... Args>
+    ItemType* allocate(Args&&... args) {
+        ItemType* location;
+        if (!free_list.empty()) {
+            location = free_list.back();
+            free_list.pop_back();
+        } else {
+            if (slabs.empty() || slab_used == slab_size) {
+                add_slab();
+            }
+            location = slabs.back() + slab_used;
+            slab_used++;
+        }
+
+        ItemType* obj = new (location) ItemType(std::forward<Args>(args)...);
+        num_items++;
+        return obj;
+    }
+
+    /**
+     * Destruct a single item. Its space is kept for the next allocate().
+     */
+    void deallocate(ItemType* obj) {
+        obj->~ItemType();
+        free_list.push_back(obj);
+        num_items--;
+    }
+
+    /**
+     * Destruct all items and give the slabs back in one go
+     */
+    void release() {
+        // Items on the free list are already destructed
+        std::sort(free_list.begin(), free_list.end());
+
+        for (std::size_t s = 0; s < slabs.size(); s++) {
+            std::size_t used = (s + 1 == slabs.size()) ? slab_used : slab_size;
+            for (std::size_t i = 0; i < used; i++) {
+                if (!std::binary_search(free_list.begin(), free_list.end(), slabs[s] + i)) {
+                    slabs[s][i].~ItemType();
+                }
+            }
+            ::operator delete(slabs[s]);
+        }
+
+        slabs.clear();
+        free_list.clear();
+        slab_used = 0;
+        num_items = 0;
+    }
+
+    /**
+     * Exchange the slabs and items of two allocators
+     */
+    void swap(ItemAllocator& other) {
+        std::swap(slab_size, other.slab_size);
+        slabs.swap(other.slabs);
+        free_list.swap(other.free_list);
+        std::swap(slab_used, other.slab_used);
+        std::swap(num_items, other.num_items);
+    }
+
+    /**
+     * Bytes held by the slabs, including unused space of the last slab
+     */
+    std::size_t capacity_bytes() const {
+        return slabs.size() * slab_size * sizeof(ItemType);
+    }
+
+    private:
+
+    void add_slab() {
+        auto slab = static_cast<ItemType*>(::operator new(slab_size * sizeof(ItemType)));
+        slabs.push_back(slab);
+        slab_used = 0;
+    }
+};
+
+} //end namespace
+
+#endif
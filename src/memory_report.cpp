@@ -0,0 +1,88 @@
+// Copyright 2019 Saddlebag Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEMORY_REPORT_CPP
+#define MEMORY_REPORT_CPP
+
+#include <cstddef>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//Memory held by a rank, by where it is used
+
+namespace saddlebags
+{
+
+/**
+ * Memory of one table
+ */
+struct TableMemory {
+    std::size_t items = 0;
+    // Slots of the hash map, and how many of them are used
+    std::size_t map_slots = 0;
+    std::size_t map_occupied = 0;
+    // Hash map, replicated items and frozen map
+    std::size_t map_bytes = 0;
+    // Item objects, including unused space of the allocator
+    std::size_t item_bytes = 0;
+    // Columns of columnar tables
+    std::size_t column_bytes = 0;
+    // Item list, scheduling bits and staged pushes
+    std::size_t list_bytes = 0;
+    // Reported by the items through memory_bytes()
+    std::size_t user_bytes = 0;
+
+    std::size_t total_bytes() const {
+        return map_bytes + item_bytes + column_bytes + list_bytes + user_bytes;
+    }
+};
+
+/**
+ * Memory of a rank. Push buffers and buffers for remote messages live in the shared segment of UPC++,
+ * everything else on the private heap.
+ */
+struct MemoryReport {
+    std::size_t send_buffer_bytes = 0;
+    std::size_t recv_buffer_bytes = 0;
+    // Bookkeeping of the Worker: communication plans, scratch space, timings and trace
+    std::size_t worker_bytes = 0;
+    std::vector<TableMemory> tables;
+
+    std::size_t segment_bytes() const {
+        return send_buffer_bytes + recv_buffer_bytes;
+    }
+
+    std::size_t total_bytes() const {
+        std::size_t total = segment_bytes() + worker_bytes;
+        for (auto& table : tables) {
+            total += table.total_bytes();
+        }
+        return total;
+    }
+};
+
+/**
+ * Bytes in MiB, for printing
+ */
+inline std::string format_bytes(std::size_t bytes) {
+    std::ostringstream s;
+    s << std::fixed << std::setprecision(1) << bytes / (1024.0 * 1024.0) << " MiB";
+    return s.str();
+}
+
+}//end namespace
+
+#endif
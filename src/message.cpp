@@ -15,9 +15,19 @@
 #ifndef MESSAGE_HPP
 #define MESSAGE_HPP
 
+#include <cstdint>
+
 namespace saddlebags
 {
 
+/**
+ * MessageKinds define what the receiving table does with a message
+ */
+enum MessageKind : uint8_t {
+    PushMessage = 0,
+    RemoveMessage = 1
+};
+
 template<typename TableKey_T=uint8_t, typename ItemKey_T=unsigned int, typename Msg_T=double>
 class Message {
 
@@ -25,6 +35,7 @@ class Message {
     Msg_T value;
     TableKey_T src_table;
     TableKey_T dest_table;
+    uint8_t kind = PushMessage;
     ItemKey_T dest_item;
     ItemKey_T src_item;
 
@@ -0,0 +1,262 @@
+// Copyright 2019 Saddlebag Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PERF_COUNTERS_CPP
+#define PERF_COUNTERS_CPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "cycle_stats.cpp"
+
+//Hardware performance counters of the calling thread, read through perf_event_open (Linux only).
+//The counters are opened as one group, so that they are scheduled onto the PMU together and read in one call.
+
+namespace saddlebags
+{
+
+enum PerfCounter {
+    PerfInstructions,
+    PerfCycles,
+    PerfCacheMisses,
+    PerfBranchMisses,
+    NumPerfCounters
+};
+
+inline const char* perf_counter_name(int counter) {
+    static const char* names[NumPerfCounters] = {
+        "instructions", "cycles", "cache_misses", "branch_misses"
+    };
+    return names[counter];
+}
+
+/**
+ * Counts of the group. Reads hold the raw counts with the time the group was enabled and on the PMU;
+ * sums of differences hold counts scaled up to the time enabled.
+ */
+struct PerfCounts {
+    uint64_t values[NumPerfCounters] = {};
+    uint64_t time_enabled = 0;
+    uint64_t time_running = 0;
+
+    /**
+     * Add the counts between two reads. When the group shared the PMU with other events (multiplexing),
+     * the counts are scaled by the time it was enabled over the time it ran, within that interval only.
+     */
+    inline void add_difference(const PerfCounts& now, const PerfCounts& before) {
+        // One of the reads failed and returned zeros. An enabled group has been enabled for some time at any read.
+        if (now.time_enabled == 0 || before.time_enabled == 0
+            || now.time_enabled < before.time_enabled || now.time_running < before.time_running) {
+            return;
+        }
+        uint64_t enabled = now.time_enabled - before.time_enabled;
+        uint64_t running = now.time_running - before.time_running;
+        double scale = (running > 0 && running < enabled) ? (double) enabled / running : 1.0;
+        for (int c = 0; c < NumPerfCounters; c++) {
+            values[c] += (uint64_t) ((now.values[c] - before.values[c]) * scale);
+        }
+        time_enabled += enabled;
+        time_running += running;
+    }
+};
+
+/**
+ * Group of counters. Counters the machine does not support, or may not be opened (see
+ * /proc/sys/kernel/perf_event_paranoid), read as 0.
+ */
+class PerfCounterGroup {
+    public:
+    int fds[NumPerfCounters];
+    // Counters in the order the group reports them
+    std::vector<int> opened;
+
+    PerfCounterGroup() {
+        for (int c = 0; c < NumPerfCounters; c++) {
+            fds[c] = -1;
+        }
+    }
+
+    ~PerfCounterGroup() {
+        close();
+    }
+
+    PerfCounterGroup(const PerfCounterGroup&) = delete;
+    PerfCounterGroup& operator=(const PerfCounterGroup&) = delete;
+
+    /**
+     * Open and start the counters. Returns false if none could be opened.
+     */
+    bool open() {
+#ifdef __linux__
+        const uint64_t configs[NumPerfCounters] = {
+            PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+        };
+
+        int leader = -1;
+        for (int c = 0; c < NumPerfCounters; c++) {
+            struct perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = configs[c];
+            attr.disabled = (leader == -1);
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            fds[c] = (int) syscall(__NR_perf_event_open, &attr, 0, -1, leader, 0);
+            if (fds[c] >= 0) {
+                if (leader == -1) {
+                    leader = fds[c];
+                }
+                opened.push_back(c);
+            }
+        }
+
+        if (leader == -1) {
+            return false;
+        }
+        ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * Raw counts since open(), with the time the group was enabled and running. See PerfCounts::add_difference().
+     */
+    void read(PerfCounts& counts) const {
+        counts = PerfCounts();
+#ifdef __linux__
+        if (opened.empty()) {
+            return;
+        }
+
+        // nr, time_enabled, time_running, then one value per counter
+        uint64_t data[3 + NumPerfCounters];
+        ssize_t bytes = ::read(fds[opened[0]], data, sizeof(data));
+        if (bytes < (ssize_t) (3 * sizeof(uint64_t))) {
+            return;
+        }
+
+        counts.time_enabled = data[1];
+        counts.time_running = data[2];
+        for (std::size_t i = 0; i < data[0] && i < opened.size(); i++) {
+            counts.values[opened[i]] = data[3 + i];
+        }
+#endif
+    }
+
+    void close() {
+#ifdef __linux__
+        for (int c = 0; c < NumPerfCounters; c++) {
+            if (fds[c] >= 0) {
+                ::close(fds[c]);
+                fds[c] = -1;
+            }
+        }
+#endif
+        opened.clear();
+    }
+};
+
+/**
+ * Counters per cycle phase, summed over all cycles, and per user region
+ */
+class PhaseCounters {
+    public:
+    bool enabled = false;
+    PerfCounterGroup group;
+    PerfCounts phase_counts[NumCyclePhases];
+    std::vector<std::string> region_names;
+    std::vector<PerfCounts> region_counts;
+
+    /**
+     * Returns false if no counter could be opened, and stays disabled then
+     */
+    bool enable() {
+        enabled = group.open();
+        return enabled;
+    }
+
+    inline void begin_laps() {
+        if (enabled) {
+            group.read(last_lap);
+        }
+    }
+
+    inline void lap(CyclePhase phase) {
+        if (enabled) {
+            PerfCounts now;
+            group.read(now);
+            phase_counts[phase].add_difference(now, last_lap);
+            last_lap = now;
+        }
+    }
+
+    int add_region(const std::string& name) {
+        region_names.push_back(name);
+        region_counts.push_back(PerfCounts());
+        region_start.push_back(PerfCounts());
+        return (int) region_names.size() - 1;
+    }
+
+    inline void begin_region(int region) {
+        if (enabled) {
+            group.read(region_start[region]);
+        }
+    }
+
+    inline void end_region(int region) {
+        if (enabled) {
+            PerfCounts now;
+            group.read(now);
+            region_counts[region].add_difference(now, region_start[region]);
+        }
+    }
+
+    /**
+     * Phases, then regions, NumPerfCounters values each
+     */
+    std::vector<uint64_t> flatten() const {
+        std::vector<uint64_t> values;
+        for (int p = 0; p < NumCyclePhases; p++) {
+            values.insert(values.end(), phase_counts[p].values, phase_counts[p].values + NumPerfCounters);
+        }
+        for (auto& counts : region_counts) {
+            values.insert(values.end(), counts.values, counts.values + NumPerfCounters);
+        }
+        return values;
+    }
+
+    private:
+    PerfCounts last_lap;
+    std::vector<PerfCounts> region_start;
+};
+
+}//end namespace
+
+#endif
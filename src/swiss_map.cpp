@@ -0,0 +1,370 @@
+// Copyright 2019 Saddlebag Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SWISS_MAP_CPP
+#define SWISS_MAP_CPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "hashf.cpp"
+
+//Hash map with a separate array of control bytes, probed one group (16 slots) at a time.
+//Each control byte is either empty, deleted, or holds the low 7 bits of the hash of a full slot.
+
+namespace saddlebags
+{
+
+const int8_t SWISS_CTRL_EMPTY = -128;
+const int8_t SWISS_CTRL_DELETED = -2;
+const std::size_t SWISS_GROUP_SIZE = 16;
+
+template<typename keyT, typename valueT>
+class SwissEntry {
+    public:
+    keyT first;
+    valueT second;
+};
+
+template<typename keyT, typename valueT> class SwissIterator;
+
+template<typename keyT, typename valueT>
+class Swiss_Map {
+    public:
+
+    using iterator = SwissIterator<keyT, valueT>;
+
+    std::size_t size = 1024;
+    int8_t* ctrl;
+    SwissEntry<keyT, valueT>* entries;
+    // Maximum load is 7/8 of the slots
+    const float load_factor = 0.875;
+    std::size_t num_items = 0;
+    std::size_t num_deleted = 0;
+
+    Swiss_Map() {
+        allocate(size);
+    }
+
+    ~Swiss_Map() {
+        delete[] ctrl;
+        delete[] entries;
+    }
+
+    Swiss_Map(const Swiss_Map&) = delete;
+    Swiss_Map& operator=(const Swiss_Map&) = delete;
+
+    iterator begin() {
+        return iterator(*this, next_full(0));
+    }
+
+    iterator end() {
+        return iterator(*this, size);
+    }
+
+    /**
+     * First full slot at or after location, or size if there is none
+     */
+    std::size_t next_full(std::size_t location) {
+        while (location < size) {
+            uint32_t mask = match_full(location & ~(SWISS_GROUP_SIZE - 1));
+            mask &= ~0u << (location & (SWISS_GROUP_SIZE - 1));
+            if (mask != 0) {
+                return (location & ~(SWISS_GROUP_SIZE - 1)) + __builtin_ctz(mask);
+            }
+            location = (location & ~(SWISS_GROUP_SIZE - 1)) + SWISS_GROUP_SIZE;
+        }
+        return size;
+    }
+
+    iterator find(keyT key) {
+        std::size_t hashed = (std::size_t) hashf(key);
+        int8_t tag = h2(hashed);
+        std::size_t num_groups = size / SWISS_GROUP_SIZE;
+        std::size_t group = h1(hashed) & (num_groups - 1);
+
+        for (std::size_t i = 0; i < num_groups; i++) {
+            std::size_t base = group * SWISS_GROUP_SIZE;
+            uint32_t mask = match_tag(base, tag);
+
+            while (mask != 0) {
+                std::size_t location = base + __builtin_ctz(mask);
+                if (entries[location].first == key) {
+                    return iterator(*this, location);
+                }
+                mask &= mask - 1;
+            }
+
+            if (match_empty(base) != 0) {
+                return end();
+            }
+
+            // Triangular probing visits every group once, as the number of groups is a power of two
+            group = (group + i + 1) & (num_groups - 1);
+        }
+
+        return end();
+    }
+
+    void insert(keyT key, valueT val) {
+        insert(key, val, hashf(key));
+    }
+
+    void insert(keyT key, valueT val, std::size_t hashed) {
+        if (above_load_factor()) {
+            // Mostly tombstones: rehashing at the same size is enough
+            expand(num_deleted >= size / 4 ? size : size * 2);
+        }
+
+        insert_new_array(key, val, hashed, ctrl, entries, size);
+        num_items += 1;
+    }
+
+    bool above_load_factor() {
+        return num_items + num_deleted + 1 > (float) size * load_factor;
+    }
+
+    /**
+     * Remove key from the map. Returns false if the key was not found.
+     */
+    bool erase(keyT key) {
+        iterator it = find(key);
+        if (it == end()) {
+            return false;
+        }
+        erase_at(it.current_loc);
+        return true;
+    }
+
+    void erase_at(std::size_t location) {
+        // A group with an empty slot ends every probe sequence that reaches it,
+        // so the slot can become empty again. Otherwise a tombstone is needed.
+        std::size_t base = location & ~(SWISS_GROUP_SIZE - 1);
+        if (match_empty(base) != 0) {
+            ctrl[location] = SWISS_CTRL_EMPTY;
+        } else {
+            ctrl[location] = SWISS_CTRL_DELETED;
+            num_deleted += 1;
+        }
+        num_items -= 1;
+    }
+
+    /**
+     * Grow the map once, so that n items fit without further expansion
+     */
+    void reserve(std::size_t n) {
+        std::size_t new_size = size;
+        while ((float) new_size * load_factor < n) {
+            new_size *= 2;
+        }
+
+        if (new_size > size) {
+            expand(new_size);
+        }
+    }
+
+    /**
+     * Insert n new keys (not already in the map), growing the map only once
+     */
+    void build(const keyT* keys, const valueT* vals, std::size_t n) {
+        reserve(num_items + n);
+
+        for (std::size_t i = 0; i < n; i++) {
+            insert_new_array(keys[i], vals[i], (std::size_t) hashf(keys[i]), ctrl, entries, size);
+            num_items += 1;
+        }
+    }
+
+    std::size_t bytes() const {
+        return size * (sizeof(int8_t) + sizeof(SwissEntry<keyT, valueT>));
+    }
+
+    void clear() {
+        std::memset(ctrl, SWISS_CTRL_EMPTY, size);
+        num_items = 0;
+        num_deleted = 0;
+    }
+
+    void expand(std::size_t new_size) {
+        int8_t* old_ctrl = ctrl;
+        SwissEntry<keyT, valueT>* old_entries = entries;
+        std::size_t old_size = size;
+
+        // Tombstones are dropped when rehashing
+        allocate(new_size);
+        num_deleted = 0;
+        for (std::size_t i = 0; i < old_size; i++) {
+            if (old_ctrl[i] >= 0) {
+                insert_new_array(old_entries[i].first, old_entries[i].second,
+                                 (std::size_t) hashf(old_entries[i].first), ctrl, entries, size);
+            }
+        }
+
+        delete[] old_ctrl;
+        delete[] old_entries;
+    }
+
+    private:
+
+    void allocate(std::size_t new_size) {
+        if (new_size < SWISS_GROUP_SIZE) {
+            new_size = SWISS_GROUP_SIZE;
+        }
+        size = new_size;
+        ctrl = new int8_t[size];
+        entries = new SwissEntry<keyT, valueT>[size];
+        std::memset(ctrl, SWISS_CTRL_EMPTY, size);
+    }
+
+    /**
+     * Place a key known to be absent into the first empty or deleted slot of its probe sequence
+     */
+    void insert_new_array(keyT key, valueT val, std::size_t hashed,
+                          int8_t* ctrl_array, SwissEntry<keyT, valueT>* entry_array, std::size_t array_size) {
+        std::size_t num_groups = array_size / SWISS_GROUP_SIZE;
+        std::size_t group = h1(hashed) & (num_groups - 1);
+
+        for (std::size_t i = 0; ; i++) {
+            std::size_t base = group * SWISS_GROUP_SIZE;
+            uint32_t mask = match_free(ctrl_array + base);
+            if (mask != 0) {
+                std::size_t location = base + __builtin_ctz(mask);
+                if (ctrl_array[location] == SWISS_CTRL_DELETED) {
+                    num_deleted -= 1;
+                }
+                ctrl_array[location] = h2(hashed);
+                entry_array[location].first = key;
+                entry_array[location].second = val;
+                return;
+            }
+            group = (group + i + 1) & (num_groups - 1);
+        }
+    }
+
+    static inline std::size_t h1(std::size_t hashed) {
+        return hashed >> 7;
+    }
+
+    static inline int8_t h2(std::size_t hashed) {
+        return (int8_t) (hashed & 0x7f);
+    }
+
+    inline uint32_t match_tag(std::size_t base, int8_t tag) const {
+#ifdef __SSE2__
+        __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl + base));
+        return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(tag), group));
+#else
+        uint32_t mask = 0;
+        for (std::size_t i = 0; i < SWISS_GROUP_SIZE; i++) {
+            mask |= (uint32_t) (ctrl[base + i] == tag) << i;
+        }
+        return mask;
+#endif
+    }
+
+    inline uint32_t match_empty(std::size_t base) const {
+        return match_empty(ctrl + base);
+    }
+
+    static inline uint32_t match_empty(const int8_t* group_ctrl) {
+#ifdef __SSE2__
+        __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group_ctrl));
+        return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(SWISS_CTRL_EMPTY), group));
+#else
+        uint32_t mask = 0;
+        for (std::size_t i = 0; i < SWISS_GROUP_SIZE; i++) {
+            mask |= (uint32_t) (group_ctrl[i] == SWISS_CTRL_EMPTY) << i;
+        }
+        return mask;
+#endif
+    }
+
+    static inline uint32_t match_free(const int8_t* group_ctrl) {
+#ifdef __SSE2__
+        // Empty and deleted slots have the sign bit set
+        __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group_ctrl));
+        return (uint32_t) _mm_movemask_epi8(group);
+#else
+        uint32_t mask = 0;
+        for (std::size_t i = 0; i < SWISS_GROUP_SIZE; i++) {
+            mask |= (uint32_t) (group_ctrl[i] < 0) << i;
+        }
+        return mask;
+#endif
+    }
+
+    inline uint32_t match_full(std::size_t base) const {
+#ifdef __SSE2__
+        // Full slots have the sign bit cleared
+        __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl + base));
+        return (~(uint32_t) _mm_movemask_epi8(group)) & 0xffff;
+#else
+        uint32_t mask = 0;
+        for (std::size_t i = 0; i < SWISS_GROUP_SIZE; i++) {
+            mask |= (uint32_t) (ctrl[base + i] >= 0) << i;
+        }
+        return mask;
+#endif
+    }
+};
+
+template<typename keyT, typename valueT>
+class SwissIterator
+{
+    public:
+    using value_type = valueT;
+    using difference_type = std::ptrdiff_t;
+    using pointer = valueT*;
+    using reference = valueT&;
+    using iterator = SwissIterator<keyT, valueT>;
+
+    Swiss_Map<keyT, valueT> &my_map;
+    std::size_t current_loc = 0;
+
+    SwissIterator(Swiss_Map<keyT, valueT>& map) : my_map(map), current_loc(0)
+    {}
+
+    SwissIterator(Swiss_Map<keyT, valueT>& map, std::size_t start_loc) : my_map(map), current_loc(start_loc)
+    {}
+
+    iterator & operator++()
+    {
+        current_loc = my_map.next_full(current_loc + 1);
+        return *this;
+    }
+
+    bool operator==(const iterator& other)
+    {
+        return (current_loc == other.current_loc);
+    }
+
+    bool operator!=(const iterator& other)
+    {
+        return (current_loc != other.current_loc);
+    }
+
+    SwissEntry<keyT, valueT> & operator*() const
+    {
+        return my_map.entries[current_loc];
+    }
+};
+
+} //end namespace
+
+#endif
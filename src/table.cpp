@@ -15,19 +15,41 @@
 #ifndef TABLECONTAINER_H
 #define TABLECONTAINER_H
 
+#include <algorithm>
 #include <assert.h>
 #include <cmath>
+#include <cstdint>
 #include <functional>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "item.cpp"
+#include "item_allocator.cpp"
+#include "frozen_map.cpp"
 #include "hash_map.cpp"
+#include "memory_report.cpp"
+#include "swiss_map.cpp"
 #include "utils.hpp"
 
 namespace saddlebags
 {
 
+#if ROBIN_HASH && SWISS_HASH
+template<typename keyT, typename valueT>
+using ItemMap = Swiss_Map<keyT, valueT>;
+#elif ROBIN_HASH
+template<typename keyT, typename valueT>
+using ItemMap = Robin_Map<keyT, valueT>;
+#else
+template<typename keyT, typename valueT>
+using ItemMap = std::unordered_map<keyT, valueT>;
+#endif
+
 template<typename TableKey_T, typename ItemKey_T, typename Msg_T> class Worker;
 
 template <typename TableKey_T, typename ItemKey_T, typename Msg_T>
@@ -40,18 +62,59 @@ class TableContainerBase
     Msg_T broadcast_value;
     ItemKey_T broadcast_origin_item;
     bool broadcast_enabled = false;
+    // Pushes are collected and delivered per item through on_push_batch()
+    bool batch_pushes = false;
+    // Only items which received a message, or were activated, run their work hooks
+    bool active_scheduling = false;
+    // With active scheduling, items stay active after they ran, until they vote to halt
+    bool keep_active = false;
+    // With active scheduling, items run in buckets of this width by priority(), lowest first (0 for slot order)
+    double priority_delta = 0;
+    // Counts changes to the slots of the items (added, removed or relocated items), which invalidate
+    // the receiving plan of the Worker (see Worker::enable_comm_plan())
+    std::size_t layout_version = 0;
 
 
+    // The values are the items of the table, as stored. For tables of StaticItems they are not Items, so read only the keys.
 #if ROBIN_HASH
-    virtual Robin_Map<ItemKey_T, Item<TableKey_T, ItemKey_T, Msg_T>*>* get_items() = 0;
+    virtual ItemMap<ItemKey_T, Item<TableKey_T, ItemKey_T, Msg_T>*>* get_items() = 0;
 #else
     virtual std::unordered_map<ItemKey_T, Item<TableKey_T, ItemKey_T, Msg_T>*>* get_items() = 0;
 #endif
 
-    virtual Item<TableKey_T, ItemKey_T, Msg_T>* create_new_item(ItemKey_T key) = 0;
+    virtual ItemBase<TableKey_T, ItemKey_T, Msg_T>* create_new_item(ItemKey_T key) = 0;
+    virtual ItemBase<TableKey_T, ItemKey_T, Msg_T>* find_item(ItemKey_T key) = 0;
+    virtual ItemBase<TableKey_T, ItemKey_T, Msg_T>* add_new_item(ItemKey_T key) = 0;
+    virtual void push_to_item(ItemBase<TableKey_T, ItemKey_T, Msg_T>* obj, Msg_T const& val) = 0;
+    virtual void refresh_item(ItemBase<TableKey_T, ItemKey_T, Msg_T>* obj) = 0;
+    virtual std::size_t slot_of(ItemBase<TableKey_T, ItemKey_T, Msg_T>* obj) = 0;
+    virtual void push_to_slot(std::size_t slot, Msg_T const& val) = 0;
+    virtual void add_new_items(const std::vector<ItemKey_T>& keys) = 0;
     virtual int apply_push_to_item(Message<TableKey_T, ItemKey_T, Msg_T> const& msg) = 0;
     virtual int apply_push_to_item(Message<TableKey_T, ItemKey_T, Msg_T> const& msg, bool is_create) = 0;
     virtual void destroy_items() = 0;
+    virtual void work() = 0;
+    virtual void reserve_items(std::size_t n) = 0;
+    virtual bool remove_item(ItemKey_T key) = 0;
+    virtual void freeze() = 0;
+    virtual void thaw() = 0;
+    virtual void stage_push(Message<TableKey_T, ItemKey_T, Msg_T> const& msg) = 0;
+    virtual void deliver_staged_pushes(bool is_create) = 0;
+    virtual void deliver_staged_pushes(ItemKey_T key, bool is_create) = 0;
+    virtual void activate_slot(std::size_t slot) = 0;
+    virtual void activate_all() = 0;
+    virtual void halt_slot(std::size_t slot) = 0;
+    virtual std::size_t count_active() = 0;
+    virtual std::size_t count_items() = 0;
+    virtual void account_memory(TableMemory& memory) = 0;
+    virtual void start_running() = 0;
+    virtual void start_buckets() = 0;
+    virtual bool lowest_bucket(long& bucket) = 0;
+    virtual void run_bucket(long bucket) = 0;
+    virtual void join_running(bool joining) = 0;
+
+    virtual ~TableContainerBase() {
+    }
 };
 
 template <typename TableKey_T, typename ItemKey_T, typename Msg_T, typename ItemType>
@@ -59,34 +122,668 @@ class TableContainer : public TableContainerBase<TableKey_T, ItemKey_T, Msg_T> {
     public:
 
 #if ROBIN_HASH
-    Robin_Map<ItemKey_T, ItemType*> mapped_items;
-    Robin_Map<ItemKey_T, ItemType*> replicated_items;
+    ItemMap<ItemKey_T, ItemType*> mapped_items;
+    ItemMap<ItemKey_T, ItemType*> replicated_items;
+    // Copy of the items for get_items(), for tables which do not keep them in mapped_items
+    ItemMap<ItemKey_T, ItemType*> items_view;
 
-    Robin_Map<ItemKey_T, Item<TableKey_T, ItemKey_T, Msg_T>*>* get_items() override {
-        return reinterpret_cast<Robin_Map<ItemKey_T, Item<TableKey_T, ItemKey_T, Msg_T>*>*>(&mapped_items);
+    ItemMap<ItemKey_T, Item<TableKey_T, ItemKey_T, Msg_T>*>* get_items() override {
+        return reinterpret_cast<ItemMap<ItemKey_T, Item<TableKey_T, ItemKey_T, Msg_T>*>*>(item_map());
     }
 #else
     std::unordered_map<ItemKey_T, ItemType*> mapped_items;
     std::unordered_map<ItemKey_T, ItemType*> replicated_items;
+    // Copy of the items for get_items(), for tables which do not keep them in mapped_items
+    std::unordered_map<ItemKey_T, ItemType*> items_view;
 
     std::unordered_map<ItemKey_T, Item<TableKey_T, ItemKey_T, Msg_T>*>* get_items() override {
-        return reinterpret_cast<std::unordered_map<ItemKey_T, Item<TableKey_T, ItemKey_T, Msg_T>*>*>(&mapped_items);
+        return reinterpret_cast<std::unordered_map<ItemKey_T, Item<TableKey_T, ItemKey_T, Msg_T>*>*>(item_map());
     }
 #endif
 
+#if SLAB_ALLOCATOR
+    ItemAllocator<ItemType> item_allocator;
+#endif
+
+    // All items of the table, packed in creation order, so that work() does not walk the map
+    std::vector<ItemType*> work_items;
+    // Key of the item in each slot, for SlimItems, which do not keep their key themselves
+    std::vector<ItemKey_T> slot_keys;
+
+    using Hooks = ItemHooks<ItemType>;
+    using Context = ItemContext<TableKey_T, ItemKey_T, Msg_T>;
+
+    // One bit per table slot, for the items to run in the next work(), when active_scheduling is set
+    std::vector<uint64_t> active_bits;
+    std::vector<uint64_t> running_bits;
+    // Items of the running work() which voted to halt, when keep_active is set
+    std::vector<uint64_t> halted_bits;
+
+    // Slots of the running items by priority bucket, with priority scheduling. An item is queued again when its
+    // priority changes, so entries are checked when they come up, and skipped once the item ran.
+    std::map<long, std::vector<std::size_t>> priority_buckets;
+    std::vector<std::size_t> bucket_slots;
+    // Set while items activated by messages join the running items, between two buckets
+    bool joining_running = false;
+
+    // Set while the work hooks of the items run. Items removed meanwhile are released once they are done,
+    // so that the item list does not change under the loop.
+    bool in_work = false;
+    std::vector<ItemKey_T> deferred_removals;
+
+    // Pushes received in this cycle, when the items take them through on_push_batch()
+    std::vector<std::pair<ItemKey_T, Msg_T>> staged_pushes;
+    std::vector<Msg_T> batch_values;
+
+    // After freeze(), all items live here and mapped_items stays empty until the table is thawed.
+    // Items can not be added or removed while the table is frozen.
+    Frozen_Map<ItemKey_T, ItemType*> frozen_items;
+    bool frozen = false;
+
+    ~TableContainer() {
+        destroy_items();
+    }
+
     /*
      *
      */
     ItemType* create_new_item(ItemKey_T key) {
+#if SLAB_ALLOCATOR
+        auto newobj = item_allocator.allocate();
+#else
         auto newobj = new ItemType();
-        newobj->worker = this->worker;
-        newobj->myItemKey = key;
-        newobj->myTableKey = this->myTableKey;
-        newobj->on_create();
-        newobj->refresh();
+#endif
+        assert(work_items.size() <= std::numeric_limits<ItemSlot>::max());
+        newobj->table_slot = work_items.size();
+        set_header(newobj, key, std::integral_constant<bool, ItemType::slim_header>());
+        work_items.push_back(newobj);
+        this->layout_version++;
+        if (this->active_scheduling) {
+            activate_slot(newobj->table_slot);
+        }
+        attach_item(newobj);
+        Hooks::create(newobj, context_of(newobj));
+        return newobj;
+    }
+
+    inline void set_header(ItemType* obj, ItemKey_T key, std::false_type) {
+        obj->worker = this->worker;
+        obj->myItemKey = key;
+        obj->myTableKey = this->myTableKey;
+    }
+
+    inline void set_header(ItemType* /*obj*/, ItemKey_T key, std::true_type) {
+        slot_keys.push_back(key);
+    }
+
+    /*
+     * Key of an item of this table
+     */
+    inline ItemKey_T key_of(ItemType* obj) const {
+        return key_of(obj, std::integral_constant<bool, ItemType::slim_header>());
+    }
+
+    inline ItemKey_T key_of(ItemType* obj, std::false_type) const {
+        return obj->myItemKey;
+    }
+
+    inline ItemKey_T key_of(ItemType* obj, std::true_type) const {
+        return slot_keys[obj->table_slot];
+    }
+
+    /*
+     * Worker, table, key and slot of an item, for its hooks
+     */
+    inline Context context_of(ItemType* obj) const {
+        return Context{this->worker, obj->table_slot, key_of(obj), this->myTableKey};
+    }
+
+    /*
+     * Return the item for key, or nullptr if it is not in the table
+     */
+    ItemType* find_item(ItemKey_T key) {
+        if (frozen) {
+            return frozen_items.values[frozen_items.find_location(key)];
+        }
+
+        auto iterator = mapped_items.find(key);
+        if (iterator == mapped_items.end()) {
+            return nullptr;
+        }
+        return (*iterator).second;
+    }
+
+    /*
+     * Create the item for a new key (not already in the table), and insert it
+     */
+    ItemType* add_new_item(ItemKey_T key) {
+        if (reject_if_frozen("add")) {
+            return nullptr;
+        }
+        auto newobj = create_new_item(key);
+#if ROBIN_HASH
+        mapped_items.insert(key, newobj);
+#else
+        mapped_items[key] = newobj;
+#endif
         return newobj;
     }
 
+    /*
+     *
+     */
+    void add_new_items(const std::vector<ItemKey_T>& keys) {
+        create_new_items(keys);
+    }
+
+    /*
+     * Size the table for n items, so that loading them does not rehash
+     */
+    void reserve_items(std::size_t n) {
+        if (reject_if_frozen("reserve")) {
+            return;
+        }
+        mapped_items.reserve(n);
+        work_items.reserve(n);
+    }
+
+    /*
+     * Create items for new keys (not already in the table), and place them in the map in one pass
+     */
+    std::vector<ItemType*> create_new_items(const std::vector<ItemKey_T>& keys) {
+        std::vector<ItemType*> new_items;
+        if (reject_if_frozen("add")) {
+            return new_items;
+        }
+        new_items.reserve(keys.size());
+        for (auto key : keys) {
+            new_items.push_back(create_new_item(key));
+        }
+
+#if ROBIN_HASH
+        mapped_items.build(keys.data(), new_items.data(), keys.size());
+#else
+        mapped_items.reserve(mapped_items.size() + keys.size());
+        for (std::size_t i = 0; i < keys.size(); i++) {
+            mapped_items[keys[i]] = new_items[i];
+        }
+#endif
+        return new_items;
+    }
+
+    /*
+     * True if mapped_items holds all items of the table. Otherwise they are stored elsewhere (in a dense
+     * array, or frozen), and get_items() returns a copy.
+     */
+    virtual bool items_in_map() {
+        return !frozen;
+    }
+
+    /*
+     * Map of all items of the table. If the table does not keep them in mapped_items, the copy is
+     * rebuilt from the item list on every call, and is valid until the next item is added or removed.
+     */
+    decltype(mapped_items)* item_map() {
+        if (items_in_map()) {
+            return &mapped_items;
+        }
+
+        items_view.clear();
+        std::vector<ItemKey_T> keys;
+        keys.reserve(work_items.size());
+        for (auto obj : work_items) {
+            keys.push_back(key_of(obj));
+        }
+#if ROBIN_HASH
+        items_view.build(keys.data(), work_items.data(), keys.size());
+#else
+        items_view.reserve(keys.size());
+        for (std::size_t i = 0; i < keys.size(); i++) {
+            items_view[keys[i]] = work_items[i];
+        }
+#endif
+        return &items_view;
+    }
+
+    /*
+     * Called for every new item before on_create(), so that derived tables can set up their own storage
+     */
+    virtual void attach_item(ItemType* /*obj*/) {
+    }
+
+    /*
+     * Called for every item that is removed, before it is released
+     */
+    virtual void detach_item(ItemType* /*obj*/) {
+    }
+
+    /*
+     * Remove an item from the table and release it. Returns false if the item was not found.
+     */
+    bool remove_item(ItemKey_T key) {
+        if (in_work) {
+            return defer_removal(key);
+        }
+        if (reject_if_frozen("remove")) {
+            return false;
+        }
+        auto iterator = mapped_items.find(key);
+        if (iterator == mapped_items.end()) {
+            return false;
+        }
+
+        auto obj = (*iterator).second;
+#if ROBIN_HASH
+        mapped_items.erase_at(iterator.current_loc);
+#else
+        mapped_items.erase(iterator);
+#endif
+        release_item(obj);
+        return true;
+    }
+
+    /*
+     * Remove an item once the work hooks are done. Returns false if the item was not found.
+     */
+    bool defer_removal(ItemKey_T key) {
+        if (find_item(key) == nullptr) {
+            return false;
+        }
+        deferred_removals.push_back(key);
+        return true;
+    }
+
+    inline void begin_work() {
+        in_work = true;
+    }
+
+    /*
+     * Apply the removals requested while the work hooks ran
+     */
+    void end_work() {
+        in_work = false;
+        if (deferred_removals.empty()) {
+            return;
+        }
+
+        std::vector<ItemKey_T> removals;
+        removals.swap(deferred_removals);
+        for (auto key : removals) {
+            remove_item(key);
+        }
+    }
+
+    /*
+     * Release an item which is no longer referenced by the table
+     */
+    void release_item(ItemType* obj) {
+        Hooks::remove(obj, context_of(obj));
+        detach_item(obj);
+
+        // Fill the hole with the last item, to keep the list packed
+        ItemType* last = work_items.back();
+        if (this->active_scheduling) {
+            move_slot_bits(last->table_slot, obj->table_slot);
+        }
+        if (ItemType::slim_header) {
+            slot_keys[obj->table_slot] = slot_keys.back();
+            slot_keys.pop_back();
+        }
+        work_items[obj->table_slot] = last;
+        last->table_slot = obj->table_slot;
+        work_items.pop_back();
+        this->layout_version++;
+        // The bucket entries of the moved item still name its old slot
+        if (!priority_buckets.empty() && last != obj && is_running(last->table_slot)) {
+            queue_in_bucket(last->table_slot);
+        }
+
+#if SLAB_ALLOCATOR
+        item_allocator.deallocate(obj);
+#else
+        delete obj;
+#endif
+    }
+
+    /*
+     * Run the work hooks of all items, for one cycle
+     */
+    void work() {
+        if (this->active_scheduling) {
+            work_active();
+            return;
+        }
+
+        begin_work();
+        const std::size_t n = work_items.size();
+        for (std::size_t i = 0; i < n; i++) {
+            if (i + WORK_PREFETCH_DISTANCE < n) {
+                __builtin_prefetch(work_items[i + WORK_PREFETCH_DISTANCE]);
+            }
+            ItemType* obj = work_items[i];
+            Hooks::work(obj, context_of(obj));
+        }
+        end_work();
+    }
+
+    /*
+     * Run the work hooks only of the items that are active, in slot order. Items activated
+     * while this runs (by themselves, or by messages) are run in the next cycle.
+     */
+    void work_active() {
+        start_running();
+
+        begin_work();
+        for (std::size_t w = 0; w < running_bits.size(); w++) {
+            uint64_t bits = running_bits[w];
+            while (bits != 0) {
+                std::size_t slot = w * 64 + __builtin_ctzll(bits);
+                bits &= bits - 1;
+                if (slot >= work_items.size()) {
+                    break;
+                }
+                run_slot(slot);
+            }
+        }
+        end_work();
+    }
+
+    /*
+     * Take the active items as the ones to run now, and start collecting those for the next run
+     */
+    void start_running() {
+        running_bits.swap(active_bits);
+        active_bits.assign(running_bits.size(), 0);
+    }
+
+    /*
+     * Run the work hooks of the item in slot
+     */
+    inline void run_slot(std::size_t slot) {
+        ItemType* obj = work_items[slot];
+        Hooks::work(obj, context_of(obj));
+
+        if (this->keep_active) {
+            if (slot / 64 < halted_bits.size() && (halted_bits[slot / 64] >> (slot % 64)) & 1) {
+                halted_bits[slot / 64] &= ~((uint64_t) 1 << (slot % 64));
+            } else {
+                activate_slot(slot);
+            }
+        }
+    }
+
+    /*
+     * After a work() that ran all running items at once, keep those active that did not vote to halt, as
+     * run_slot() does for a single item
+     */
+    void keep_unhalted_active() {
+        std::size_t words = std::min(running_bits.size(), (work_items.size() + 63) / 64);
+        if (active_bits.size() < words) {
+            active_bits.resize(words, 0);
+        }
+        for (std::size_t w = 0; w < words; w++) {
+            uint64_t halted = w < halted_bits.size() ? halted_bits[w] : 0;
+            active_bits[w] |= running_bits[w] & ~halted;
+        }
+        if (words > 0 && work_items.size() % 64 != 0 && words == (work_items.size() + 63) / 64) {
+            active_bits[words - 1] &= ((uint64_t) 1 << (work_items.size() % 64)) - 1;
+        }
+        std::fill(halted_bits.begin(), halted_bits.end(), 0);
+    }
+
+    /*
+     * Bucket of the priority of an item. Priorities above the range of buckets, +inf and NaN fall into the last
+     * bucket, those below it and -inf into the first.
+     */
+    inline long get_bucket(ItemType* obj) const {
+        double scaled = obj->priority() / this->priority_delta;
+        if (std::isnan(scaled) || scaled >= (double) std::numeric_limits<long>::max()) {
+            return std::numeric_limits<long>::max();
+        }
+        if (scaled <= (double) std::numeric_limits<long>::min()) {
+            return std::numeric_limits<long>::min();
+        }
+        return (long) std::floor(scaled);
+    }
+
+    inline bool is_running(std::size_t slot) const {
+        return slot / 64 < running_bits.size() && (running_bits[slot / 64] >> (slot % 64)) & 1;
+    }
+
+    inline void queue_in_bucket(std::size_t slot) {
+        priority_buckets[get_bucket(work_items[slot])].push_back(slot);
+    }
+
+    /*
+     * Take the active items as the ones to run now, each queued in the bucket of its priority
+     */
+    void start_buckets() {
+        start_running();
+        priority_buckets.clear();
+        for (std::size_t w = 0; w < running_bits.size(); w++) {
+            uint64_t bits = running_bits[w];
+            while (bits != 0) {
+                std::size_t slot = w * 64 + __builtin_ctzll(bits);
+                bits &= bits - 1;
+                if (slot >= work_items.size()) {
+                    running_bits[w] &= ~((uint64_t) 1 << (slot % 64));
+                    continue;
+                }
+                queue_in_bucket(slot);
+            }
+        }
+    }
+
+    /*
+     * Lowest bucket with items still to run. Returns false if there are none.
+     */
+    bool lowest_bucket(long& bucket) {
+        while (!priority_buckets.empty() && priority_buckets.begin()->second.empty()) {
+            priority_buckets.erase(priority_buckets.begin());
+        }
+        if (priority_buckets.empty()) {
+            return false;
+        }
+        bucket = priority_buckets.begin()->first;
+        return true;
+    }
+
+    /*
+     * Run the items queued in bucket. An item whose priority rose since it was queued moves to its new bucket.
+     */
+    void run_bucket(long bucket) {
+        auto entry = priority_buckets.find(bucket);
+        if (entry == priority_buckets.end()) {
+            return;
+        }
+        bucket_slots.clear();
+        bucket_slots.swap(entry->second);
+        priority_buckets.erase(entry);
+
+        begin_work();
+        for (auto slot : bucket_slots) {
+            if (slot >= work_items.size() || !is_running(slot)) {
+                continue;
+            }
+            if (get_bucket(work_items[slot]) > bucket) {
+                queue_in_bucket(slot);
+                continue;
+            }
+            running_bits[slot / 64] &= ~((uint64_t) 1 << (slot % 64));
+            run_slot(slot);
+        }
+        end_work();
+    }
+
+    /*
+     * While joining, items activated by messages run in the remaining buckets of this work(), instead of the next
+     */
+    void join_running(bool joining) {
+        joining_running = joining;
+    }
+
+    /*
+     * Mark the item in slot to run in the next work()
+     */
+    void activate_slot(std::size_t slot) {
+        if (joining_running) {
+            if (slot / 64 >= running_bits.size()) {
+                running_bits.resize(slot / 64 + 1, 0);
+            }
+            running_bits[slot / 64] |= (uint64_t) 1 << (slot % 64);
+            queue_in_bucket(slot);
+            return;
+        }
+        if (slot / 64 >= active_bits.size()) {
+            active_bits.resize(slot / 64 + 1, 0);
+        }
+        active_bits[slot / 64] |= (uint64_t) 1 << (slot % 64);
+    }
+
+    /*
+     * The item in slot stays dormant after this run, until a message arrives
+     */
+    void halt_slot(std::size_t slot) {
+        if (slot / 64 >= halted_bits.size()) {
+            halted_bits.resize(slot / 64 + 1, 0);
+        }
+        halted_bits[slot / 64] |= (uint64_t) 1 << (slot % 64);
+    }
+
+    /*
+     * Number of items that would run in the next work()
+     */
+    std::size_t count_active() {
+        if (!this->active_scheduling) {
+            return work_items.size();
+        }
+
+        std::size_t active = 0;
+        for (auto bits : active_bits) {
+            active += __builtin_popcountll(bits);
+        }
+        return active;
+    }
+
+    /*
+     *
+     */
+    void activate_all() {
+        for (std::size_t slot = 0; slot < work_items.size(); slot++) {
+            activate_slot(slot);
+        }
+    }
+
+    /*
+     * Called when obj got a message, which makes it active under active_scheduling
+     */
+    inline void mark_received(ItemType* obj) {
+        if (this->active_scheduling) {
+            activate_slot(obj->table_slot);
+        }
+    }
+
+    std::size_t count_items() override {
+        return work_items.size();
+    }
+
+    /*
+     * Memory held by the table. Walks all items if their type reports memory_bytes().
+     */
+    void account_memory(TableMemory& memory) override {
+        memory.items = work_items.size();
+#if ROBIN_HASH
+        memory.map_slots = mapped_items.size;
+        memory.map_occupied = mapped_items.num_items;
+        memory.map_bytes = mapped_items.bytes() + replicated_items.bytes() + items_view.bytes();
+#else
+        memory.map_slots = mapped_items.bucket_count();
+        memory.map_occupied = mapped_items.size();
+        // Buckets, and one node per entry
+        memory.map_bytes = (mapped_items.bucket_count() + replicated_items.bucket_count() + items_view.bucket_count()) * sizeof(void*)
+            + (mapped_items.size() + replicated_items.size() + items_view.size()) * (sizeof(std::pair<ItemKey_T, ItemType*>) + sizeof(void*));
+#endif
+        memory.map_bytes += frozen_items.bytes();
+
+#if SLAB_ALLOCATOR
+        memory.item_bytes = item_allocator.capacity_bytes();
+#else
+        memory.item_bytes = work_items.size() * sizeof(ItemType);
+#endif
+
+        memory.list_bytes = work_items.capacity() * sizeof(ItemType*) + slot_keys.capacity() * sizeof(ItemKey_T)
+            + (active_bits.capacity() + running_bits.capacity() + halted_bits.capacity()) * sizeof(uint64_t)
+            + bucket_slots.capacity() * sizeof(std::size_t)
+            + staged_pushes.capacity() * sizeof(std::pair<ItemKey_T, Msg_T>)
+            + batch_values.capacity() * sizeof(Msg_T);
+
+        if (has_memory_bytes<ItemType>::value) {
+            for (auto obj : work_items) {
+                memory.user_bytes += obj->memory_bytes();
+            }
+        }
+    }
+
+    /*
+     * Deliver a push to an item of this table found earlier
+     */
+    void push_to_item(ItemBase<TableKey_T, ItemKey_T, Msg_T>* obj, Msg_T const& val) override {
+        auto item = static_cast<ItemType*>(obj);
+        Hooks::push_recv(item, context_of(item), val);
+        mark_received(item);
+    }
+
+    /*
+     * Call the refresh hook of an item of this table found earlier
+     */
+    void refresh_item(ItemBase<TableKey_T, ItemKey_T, Msg_T>* obj) override {
+        auto item = static_cast<ItemType*>(obj);
+        Hooks::refresh(item, context_of(item));
+    }
+
+    std::size_t slot_of(ItemBase<TableKey_T, ItemKey_T, Msg_T>* obj) override {
+        return static_cast<ItemType*>(obj)->table_slot;
+    }
+
+    /*
+     * Deliver a push to the item in a slot, for pushes whose item was resolved before (see Worker::enable_comm_plan())
+     */
+    void push_to_slot(std::size_t slot, Msg_T const& val) override {
+        ItemType* obj = work_items[slot];
+        if (this->batch_pushes) {
+            staged_pushes.emplace_back(key_of(obj), val);
+        } else {
+            Hooks::push_recv(obj, context_of(obj), val);
+            mark_received(obj);
+        }
+    }
+
+    /*
+     * The item in slot from moves to slot to, when the packed list is compacted. All scheduling bits follow it,
+     * as removals may happen between the buckets of a running work().
+     */
+    void move_slot_bits(std::size_t from, std::size_t to) {
+        move_bit(active_bits, from, to);
+        move_bit(running_bits, from, to);
+        move_bit(halted_bits, from, to);
+    }
+
+    static void move_bit(std::vector<uint64_t>& bits, std::size_t from, std::size_t to) {
+        bool set = from / 64 < bits.size() && (bits[from / 64] >> (from % 64)) & 1;
+        if (to / 64 < bits.size()) {
+            bits[to / 64] &= ~((uint64_t) 1 << (to % 64));
+        }
+        if (from / 64 < bits.size()) {
+            bits[from / 64] &= ~((uint64_t) 1 << (from % 64));
+        }
+        if (set) {
+            if (to / 64 >= bits.size()) {
+                bits.resize(to / 64 + 1, 0);
+            }
+            bits[to / 64] |= (uint64_t) 1 << (to % 64);
+        }
+    }
+
     /**
      *
      * @param msg
@@ -94,7 +791,7 @@ class TableContainer : public TableContainerBase<TableKey_T, ItemKey_T, Msg_T> {
      * @return
      */
     int apply_push_to_item(Message<TableKey_T, ItemKey_T, Msg_T> const& msg) {
-        apply_push_to_item(msg, true);
+        return apply_push_to_item(msg, true);
     }
 
     /**
@@ -119,25 +816,19 @@ class TableContainer : public TableContainerBase<TableKey_T, ItemKey_T, Msg_T> {
         }
 
         ItemKey_T key = msg.dest_item;
-        auto iterator = mapped_items.find(key);
-        if(iterator == mapped_items.end()) {
-            if (is_create) {
-                auto newobj = create_new_item(key);
-                newobj->on_push_recv(msg.value);
+        auto obj = find_item(key);
+        if(obj == nullptr) {
+            if (is_create && !frozen) {
+                auto newobj = add_new_item(key);
+                Hooks::push_recv(newobj, context_of(newobj), msg.value);
+                mark_received(newobj);
                 status = CREATED_NEW_LOCAL;
-
-#if ROBIN_HASH
-                mapped_items.insert(key, newobj);
-#else
-                mapped_items[key] = newobj;
-#endif
             } else {
                 status = IGNORED_NEW_LOCAL;
             }
         } else {
-            assert((*iterator).second != NULL);
-            auto obj = (*iterator).second;
-            obj->on_push_recv(msg.value);
+            Hooks::push_recv(obj, context_of(obj), msg.value);
+            mark_received(obj);
             status = FOUND_EXISTING_LOCAL;
         }
 
@@ -145,10 +836,223 @@ class TableContainer : public TableContainerBase<TableKey_T, ItemKey_T, Msg_T> {
     }
 
     /*
-     *
+     * Keep a push until all buffers of the cycle have been received
+     */
+    void stage_push(Message<TableKey_T, ItemKey_T, Msg_T> const& msg) {
+        staged_pushes.emplace_back(msg.dest_item, msg.value);
+    }
+
+    /*
+     * Group the staged pushes by item, and hand each item all of its values in one call.
+     * Sorting is stable, so every item sees its values in the order they were received.
+     */
+    void deliver_staged_pushes(bool is_create) {
+        std::stable_sort(staged_pushes.begin(), staged_pushes.end(),
+            [](const std::pair<ItemKey_T, Msg_T>& a, const std::pair<ItemKey_T, Msg_T>& b) {
+                return a.first < b.first;
+            });
+
+        std::size_t i = 0;
+        while (i < staged_pushes.size()) {
+            ItemKey_T key = staged_pushes[i].first;
+            batch_values.clear();
+            for (; i < staged_pushes.size() && staged_pushes[i].first == key; i++) {
+                batch_values.push_back(staged_pushes[i].second);
+            }
+            deliver_batch_values(key, is_create);
+        }
+
+        staged_pushes.clear();
+    }
+
+    /*
+     * Deliver the pushes staged so far for one item only, e.g. before a removal of the item is applied,
+     * so that the item sees them just as it would have without batching
+     */
+    void deliver_staged_pushes(ItemKey_T key, bool is_create) {
+        batch_values.clear();
+        auto kept = staged_pushes.begin();
+        for (auto it = staged_pushes.begin(); it != staged_pushes.end(); ++it) {
+            if (it->first == key) {
+                batch_values.push_back(it->second);
+            } else {
+                *kept++ = *it;
+            }
+        }
+        staged_pushes.erase(kept, staged_pushes.end());
+
+        if (!batch_values.empty()) {
+            deliver_batch_values(key, is_create);
+        }
+    }
+
+    /*
+     * Hand batch_values to the item of key, creating it if needed
+     */
+    void deliver_batch_values(ItemKey_T key, bool is_create) {
+        ItemType* obj = find_item(key);
+        if (obj == nullptr && is_create && !frozen) {
+            obj = add_new_item(key);
+        }
+        if (obj != nullptr) {
+            Hooks::push_batch(obj, context_of(obj), batch_values.data(), batch_values.size());
+            mark_received(obj);
+        }
+    }
+
+    /*
+     * Release all items of this table. The map is emptied as well, so that
+     * no dangling pointers remain.
      */
     void destroy_items() {
-        // TODO: Stored in target_table->get_items();
+#if SLAB_ALLOCATOR
+        item_allocator.release();
+#else
+        for (auto obj : work_items) {
+            delete obj;
+        }
+#endif
+
+        work_items.clear();
+        slot_keys.clear();
+        active_bits.clear();
+        running_bits.clear();
+        halted_bits.clear();
+        priority_buckets.clear();
+        joining_running = false;
+        staged_pushes.clear();
+        batch_values.clear();
+        deferred_removals.clear();
+        mapped_items.clear();
+        items_view.clear();
+        frozen_items.clear();
+        frozen = false;
+        this->layout_version++;
+    }
+
+    /*
+     * Move all items from the hash map into a compact sorted layout, for tables whose item set no longer
+     * changes. Items are relocated in key order, so that work() and lookups walk memory front to back;
+     * pointers to items taken before are no longer valid. Lookups keep working as before, while adding
+     * or removing items is rejected until the table is thawed.
+     */
+    void freeze() {
+        if (frozen) {
+            return;
+        }
+        this->layout_version++;
+
+        std::vector<std::pair<ItemKey_T, ItemType*>> pairs;
+        pairs.reserve(work_items.size());
+        for (auto obj : work_items) {
+            pairs.emplace_back(key_of(obj), obj);
+        }
+        std::sort(pairs.begin(), pairs.end(),
+            [](const std::pair<ItemKey_T, ItemType*>& a, const std::pair<ItemKey_T, ItemType*>& b) {
+                return a.first < b.first;
+            });
+        relocate_items(pairs, std::is_move_constructible<ItemType>());
+        frozen_items.build(pairs);
+
+        // Give the memory of the hash map back
+        mapped_items.clear();
+#if ROBIN_HASH
+        mapped_items.expand(16);
+#else
+        mapped_items.rehash(0);
+#endif
+        frozen = true;
+    }
+
+    /*
+     * Move the items into new memory in the order of pairs, which also becomes their slot order
+     */
+    void relocate_items(std::vector<std::pair<ItemKey_T, ItemType*>>& pairs, std::true_type) {
+        std::vector<std::size_t> old_slots(pairs.size());
+#if SLAB_ALLOCATOR
+        ItemAllocator<ItemType> relocated;
+#endif
+        for (std::size_t i = 0; i < pairs.size(); i++) {
+            ItemType* obj = pairs[i].second;
+            old_slots[i] = obj->table_slot;
+#if SLAB_ALLOCATOR
+            ItemType* moved = relocated.allocate(std::move(*obj));
+#else
+            ItemType* moved = new ItemType(std::move(*obj));
+            delete obj;
+#endif
+            moved->table_slot = i;
+            work_items[i] = moved;
+            pairs[i].second = moved;
+        }
+#if SLAB_ALLOCATOR
+        // The old slabs, with the moved-from items, are released with relocated
+        item_allocator.swap(relocated);
+#endif
+        reorder_slots(old_slots);
+    }
+
+    /*
+     * Items that can not be moved stay where they are
+     */
+    void relocate_items(std::vector<std::pair<ItemKey_T, ItemType*>>& pairs, std::false_type) {
+    }
+
+    /*
+     * The item in slot old_slots[i] moved to slot i. Per-slot state follows the items.
+     */
+    virtual void reorder_slots(const std::vector<std::size_t>& old_slots) {
+        std::vector<uint64_t> bits(std::max(active_bits.size(), (old_slots.size() + 63) / 64), 0);
+        for (std::size_t i = 0; i < old_slots.size(); i++) {
+            std::size_t from = old_slots[i];
+            if (from / 64 < active_bits.size() && (active_bits[from / 64] >> (from % 64)) & 1) {
+                bits[i / 64] |= (uint64_t) 1 << (i % 64);
+            }
+        }
+        active_bits.swap(bits);
+
+        if (ItemType::slim_header) {
+            std::vector<ItemKey_T> keys(old_slots.size());
+            for (std::size_t i = 0; i < old_slots.size(); i++) {
+                keys[i] = slot_keys[old_slots[i]];
+            }
+            slot_keys.swap(keys);
+        }
+    }
+
+    /*
+     * Adding or removing items of a frozen table is an error
+     */
+    bool reject_if_frozen(const char* change) {
+        if (frozen) {
+            std::cout << "[Rank " << upcxx::rank_me() << "]"
+                      << " Error: Can not " << change << " items of table " << (int) this->myTableKey
+                      << " while it is frozen, thaw it first."
+                      << std::endl;
+        }
+        return frozen;
+    }
+
+    /*
+     * Move the items of a frozen table back into the hash map
+     */
+    void thaw() override {
+        if (!frozen) {
+            return;
+        }
+        this->layout_version++;
+
+        std::size_t n = frozen_items.num_items;
+#if ROBIN_HASH
+        mapped_items.build(frozen_items.keys.data() + 1, frozen_items.values.data() + 1, n);
+#else
+        mapped_items.reserve(n);
+        for (std::size_t i = 1; i <= n; i++) {
+            mapped_items[frozen_items.keys[i]] = frozen_items.values[i];
+        }
+#endif
+        frozen_items.clear();
+        frozen = false;
     }
 };
 
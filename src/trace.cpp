@@ -0,0 +1,161 @@
+// Copyright 2019 Saddlebag Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TRACE_CPP
+#define TRACE_CPP
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+#include "cycle_stats.cpp"
+#include "utils.hpp"
+
+//Event trace of a rank, in the Chrome trace format (chrome://tracing, ui.perfetto.dev).
+//Events go to a buffer allocated up front, and are only formatted when the trace is written.
+//Each rank writes its own file, with the rank as process id, so that the files of all ranks can be merged
+//into one timeline, e.g. with jq -s add trace.*.json > trace.json
+
+namespace saddlebags
+{
+
+struct TraceEvent {
+    // Names are not copied, they must outlive the tracer (string literals)
+    const char* name;
+    // Chrome trace phase: B/E span, X complete span, b/e async span (rgets), i instant
+    char phase;
+    double ts_us;
+    double dur_us;
+    // Peer rank for communication events, cycle for cycle spans, -1 for none
+    long arg;
+};
+
+class Tracer {
+    public:
+    using Clock = std::chrono::steady_clock;
+
+    bool enabled = false;
+    std::vector<TraceEvent> events;
+    std::size_t dropped = 0;
+
+    /**
+     * Start tracing, with room for capacity events. Once full, further events are counted as dropped.
+     */
+    void enable(std::size_t capacity = TRACE_MAX_EVENTS) {
+        enabled = true;
+        events.clear();
+        events.reserve(capacity);
+        dropped = 0;
+        origin = Clock::now();
+        last_lap = origin;
+        // Timestamps are relative to the wall clock, so that traces of different nodes line up
+        origin_us = (double) std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    inline void begin(const char* name, long arg = -1) {
+        if (enabled) {
+            add(name, 'B', Clock::now(), 0, arg);
+        }
+    }
+
+    inline void end(const char* name, long arg = -1) {
+        if (enabled) {
+            add(name, 'E', Clock::now(), 0, arg);
+        }
+    }
+
+    /**
+     * Communication with a peer, which may overlap with other communication
+     */
+    inline void begin_async(const char* name, int peer) {
+        if (enabled) {
+            add(name, 'b', Clock::now(), 0, peer);
+        }
+    }
+
+    inline void end_async(const char* name, int peer) {
+        if (enabled) {
+            add(name, 'e', Clock::now(), 0, peer);
+        }
+    }
+
+    /**
+     * Start measuring cycle phases from now
+     */
+    inline void begin_laps() {
+        if (enabled) {
+            last_lap = Clock::now();
+        }
+    }
+
+    /**
+     * Span of a cycle phase, from the previous lap until now
+     */
+    inline void lap(CyclePhase phase) {
+        if (enabled) {
+            auto now = Clock::now();
+            add(cycle_phase_name(phase), 'X', last_lap, std::chrono::duration<double, std::micro>(now - last_lap).count(), -1);
+            last_lap = now;
+        }
+    }
+
+    void write_json(std::ostream& out, int rank) const {
+        out << "[";
+        bool first = true;
+        for (auto& event : events) {
+            out << (first ? "\n" : ",\n")
+                << "{\"name\": \"" << event.name << "\", \"ph\": \"" << event.phase << "\""
+                << ", \"ts\": " << std::fixed << event.ts_us << std::defaultfloat
+                << ", \"pid\": " << rank << ", \"tid\": 0";
+            if (event.phase == 'X') {
+                out << ", \"dur\": " << event.dur_us;
+            }
+            if (event.phase == 'b' || event.phase == 'e') {
+                // Async spans pair up by category and id, one id per peer
+                out << ", \"cat\": \"comm\", \"id\": " << event.arg;
+            }
+            if (event.arg >= 0) {
+                out << ", \"args\": {\"" << (event.phase == 'B' || event.phase == 'E' ? "value" : "peer") << "\": " << event.arg << "}";
+            }
+            out << "}";
+            first = false;
+        }
+        if (dropped > 0) {
+            out << (first ? "\n" : ",\n")
+                << "{\"name\": \"dropped_events\", \"ph\": \"i\", \"s\": \"p\", \"ts\": " << std::fixed << origin_us << std::defaultfloat
+                << ", \"pid\": " << rank << ", \"tid\": 0, \"args\": {\"count\": " << dropped << "}}";
+        }
+        out << "\n]\n";
+    }
+
+    private:
+    Clock::time_point origin;
+    Clock::time_point last_lap;
+    double origin_us = 0;
+
+    inline void add(const char* name, char phase, Clock::time_point at, double dur_us, long arg) {
+        if (events.size() == events.capacity()) {
+            dropped++;
+            return;
+        }
+        double ts_us = origin_us + std::chrono::duration<double, std::micro>(at - origin).count();
+        events.push_back(TraceEvent{name, phase, ts_us, dur_us, arg});
+    }
+};
+
+}//end namespace
+
+#endif
@@ -15,6 +15,8 @@
 #ifndef UTILS_HPP
 #define UTILS_HPP
 
+#include <cstdint>
+
 // These flags are to control various features of Saddlebag
 #define INITIAL_RESERVE_SIZE 500
 // Set to [1-10] for how frequently call upcxx::progress()
@@ -29,6 +31,27 @@
 
 // Use robin hood hashing for storing items (instead of std::unordered_map)
 #define ROBIN_HASH true
+// Use Swiss table with SIMD probed control bytes for storing items (instead of Robin_Map)
+// Only used when ROBIN_HASH is set to true
+#define SWISS_HASH false
+// Use slab allocator for items (instead of one heap allocation per item)
+#define SLAB_ALLOCATOR true
+// Number of items allocated together in one slab
+#define SLAB_ITEMS_PER_CHUNK 4096
+// Set to true for tables of more than 2^32 items on one rank, which need 64-bit slots in the header of each item
+#define LARGE_TABLES false
+// Number of items ahead that work() prefetches, while streaming over the items of a table
+#define WORK_PREFETCH_DISTANCE 8
+// In async mode, send a buffer to its rank once it is filled this far (fraction of the buffer size)
+#define ASYNC_FLUSH_FILL 0.5
+// In async mode, send the buffers to other ranks at least this often (seconds)
+#define ASYNC_FLUSH_SECONDS 0.01
+// Low bits of the size word of a push buffer that count messages, the high bits hold the generation of the exchange
+#define BUFFER_SIZE_COUNT_BITS 48
+// Number of most recent cycles kept per rank, when phase timings are enabled
+#define PHASE_TIMINGS_CYCLES 4096
+// Number of events a rank can record, when tracing is enabled
+#define TRACE_MAX_EVENTS 1000000
 // Use CityHash for distributing items to partitions (instead of simple modulo operator)
 #define CITY_HASH 42002
 // Use xxHash for distributing items to partitions
@@ -164,6 +187,45 @@ inline std::size_t distrib_hash(const unsigned int & key) {
 #endif
 }
 
+/**
+ * Multiplier for fastmod_u32() by divisor d (Lemire et al., "Faster Remainder by Direct Computation")
+ */
+inline uint64_t fastmod_multiplier(uint32_t d) {
+    return UINT64_C(0xFFFFFFFFFFFFFFFF) / d + 1;
+}
+
+/**
+ * a % d for 32-bit values, with two multiplications instead of a division
+ */
+inline uint32_t fastmod_u32(uint32_t a, uint64_t multiplier, uint32_t d) {
+    uint64_t low = multiplier * a;
+    return (uint32_t) (((__uint128_t) low * d) >> 64);
+}
+
+/**
+ * Size word of a push buffer: messages in the low bits, generation (number of exchanges so far, wrapping) in the high bits
+ */
+inline std::size_t pack_buffer_size(std::size_t count, std::size_t generation) {
+    return (generation << BUFFER_SIZE_COUNT_BITS) | count;
+}
+
+inline std::size_t buffer_size_count(std::size_t word) {
+    return word & ((std::size_t(1) << BUFFER_SIZE_COUNT_BITS) - 1);
+}
+
+inline std::size_t buffer_size_generation(std::size_t word) {
+    return word >> BUFFER_SIZE_COUNT_BITS;
+}
+
+/**
+ * States of the communication plan of a Worker, on the sending and the receiving side
+ */
+enum CommPlanState {
+    PlanOff,
+    PlanRecording,
+    PlanReplaying
+};
+
 /**
  * SendingModes define the behaviour of outgoing messages from Items
  */
@@ -171,6 +233,14 @@ enum SendingMode {
     Combining
 };
 
+/**
+ * TableLayouts define how a table stores and finds its Items
+ */
+enum TableLayout {
+    HashedTable, // Items in a hash map, for any key type
+    DenseTable   // Items in an array indexed by the key, for compact integer keys
+};
+
 }
 
 #endif
@@ -15,16 +15,25 @@
 #ifndef WORKER_CPP
 #define WORKER_CPP
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
+#include <cstring>
 #include <ctime>
+#include <fstream>
 #include <iostream>
 #include <sstream>
 #include <typeinfo>
+#include <unistd.h>
 #include <unordered_map>
 #include <upcxx/upcxx.hpp>
 
 #include "table.cpp"
+#include "column_table.cpp"
+#include "cycle_stats.cpp"
+#include "dense_table.cpp"
+#include "perf_counters.cpp"
+#include "trace.cpp"
 #include "utils.hpp"
 
 namespace saddlebags {
@@ -48,6 +57,7 @@ class Worker {
     SendingMode sending_mode = Combining;
     unsigned int replication_level = 0;
     unsigned int cycles_counter = 0;
+    bool buffers_gptr_ready = false;
 
     Worker(std::size_t buffer_size = INITIAL_RESERVE_SIZE, SendingMode mode = Combining) {
         BUFFER_MAX_SIZE = buffer_size;
@@ -56,15 +66,24 @@ class Worker {
         tables.reserve(5);
         create_buffers();
         create_buffers_gptr_init();
+        async_peers = new upcxx::dist_object<Worker*>(this);
     }
 
     /**
-     * Destructor: Release memory from buffers
+     * Destructor: Release memory from buffers, items and tables
      */
     ~Worker() {
+        if (!phase_timings_path.empty()) {
+            write_phase_timings(phase_timings_path);
+        }
+        if (!trace_path.empty()) {
+            write_trace(trace_path);
+        }
         clear_buffers();
         destroy_buffers();
+        delete async_peers;
         destroy_items();
+        destroy_tables();
     }
 
      /**
@@ -78,6 +97,16 @@ class Worker {
         return distrib_hash(item_key) % total_workers;
     }
 
+    /**
+     * Ranks of n keys of one table, computed in one pass before any message is written.
+     * Under MODULO_HASH with integer keys, the modulo is a multiplication by a precomputed
+     * inverse instead of a division per key; other distributions hash each key as get_partition() does.
+     */
+    void get_partitions(const TableKey_T & table_key, const ItemKey_T* item_keys, std::size_t n, std::size_t* ranks) {
+        get_partitions(table_key, item_keys, n, ranks,
+            std::integral_constant<bool, std::is_integral<ItemKey_T>::value && DISTRIB_HASH == MODULO_HASH>());
+    }
+
     /*******************************************
      *                                        *
      *                 TABLES                 *
@@ -85,21 +114,56 @@ class Worker {
      ******************************************/
 
     /**
-     * Add a new table to a worker, given an item class
+     * Add a new table to a worker, given an item class.
+     * If known, expected_items is the number of items this rank will hold, so that space is reserved up front.
+     * Use layout DenseTable for integer keys that are dense in [key_begin, key_end). Keys outside the range
+     * are rejected. Without a range, keys start at 0 and the table grows with the largest key.
      */
     template<template<typename, typename, typename> class ObjectType>
-    void add_table(TableKey_T table_key, bool is_global = true) {
-        auto table = new TableContainer<TableKey_T, ItemKey_T, Msg_T, ObjectType<TableKey_T, ItemKey_T, Msg_T>>();
+    void add_table(TableKey_T table_key, bool is_global = true, std::size_t expected_items = 0,
+                   TableLayout layout = HashedTable, ItemKey_T key_begin = ItemKey_T(), ItemKey_T key_end = ItemKey_T()) {
+        using ItemType = ObjectType<TableKey_T, ItemKey_T, Msg_T>;
+        // Items which declare columns are stored in a columnar table
+        using TableType = typename std::conditional<has_columns<ItemType>::value,
+            ColumnTableContainer<TableKey_T, ItemKey_T, Msg_T, ItemType>,
+            TableContainer<TableKey_T, ItemKey_T, Msg_T, ItemType>>::type;
+        // Only MODULO_HASH spreads a key range evenly, other distributions would need the whole range on each rank
+        constexpr bool dense_supported = std::is_integral<ItemKey_T>::value && !has_columns<ItemType>::value
+            && DISTRIB_HASH == MODULO_HASH;
+        using DenseType = typename std::conditional<dense_supported,
+            DenseTableContainer<TableKey_T, ItemKey_T, Msg_T, ItemType>,
+            TableType>::type;
+
+        TableContainerBase<TableKey_T, ItemKey_T, Msg_T>* table;
+        if (layout == DenseTable && dense_supported) {
+            auto dense_table = new DenseType();
+            if (set_dense_range(dense_table, key_begin, key_end, 0)) {
+                table = dense_table;
+            } else {
+                if (rank_me_ == 0) {
+                    print_message("Dense layout needs a key range from 0 up on more than one rank, using hashed layout instead.");
+                }
+                delete dense_table;
+                table = new TableType();
+            }
+        } else {
+            if (layout == DenseTable && rank_me_ == 0) {
+                print_message("Dense layout needs integer keys without columns, and MODULO_HASH, using hashed layout instead.");
+            }
+            table = new TableType();
+        }
         tables.push_back(table);
         assert(table_key == tables.size() - 1);
 
         tables[table_key]->is_global = is_global;
         tables[table_key]->myTableKey = table_key;
         tables[table_key]->worker = this;
+        tables[table_key]->batch_pushes = has_push_batch<ItemType, TableKey_T, ItemKey_T, Msg_T>::value;
         total_tables = tables.size();
 
-        // TODO: How to reserve space for items?
-        // tables[table_key]->mapped_items.reserve(INITIAL_RESERVE_SIZE);
+        if (expected_items > 0) {
+            tables[table_key]->reserve_items(expected_items);
+        }
 
         // TODO [Enhancement]: Support arbitrary Table ID. Simplify storing list of tables.
         //                     Right now value > 0 will cause error for the first table to be added.
@@ -115,6 +179,10 @@ class Worker {
      * Enqueue push request in outgoing buffers
      */
     void enqueue_push_request(Message<TableKey_T, ItemKey_T, Msg_T> const& msg) {
+        if (comm_plan_enabled && replay_push(msg)) {
+            return;
+        }
+
         // Using source and destination item, find the right buffer
         // int src_rank = get_partition(msg.src_table, msg.src_item);
         int dest_rank = get_partition(msg.dest_table, msg.dest_item);
@@ -131,14 +199,25 @@ class Worker {
                 // assert(messages_total < BUFFER_MAX_SIZE);
             }
 
+            if (messages_total >= BUFFER_MAX_SIZE && async_running && dest_rank != rank_me_) {
+                // In async mode a full buffer to another rank is sent right away
+                flush_async_buffer(dest_rank);
+                messages_total = 0;
+            }
+
             if (messages_total >= BUFFER_MAX_SIZE) {
-                *(my_push_buffers_size.at(dest_rank)) = messages_total + 1;
+                set_messages_count_send(dest_rank, messages_total + 1);
+                send_plan_broken = true;
                 return; // ERROR: Out of space
             }
 
+            if (comm_plan_enabled) {
+                record_push(msg, dest_rank, messages_total);
+            }
+
             auto send_buffer = my_push_buffers.at(dest_rank);
             send_buffer[messages_total] = msg;
-            *(my_push_buffers_size.at(dest_rank)) = messages_total + 1;
+            set_messages_count_send(dest_rank, messages_total + 1);
 
         } else {
             std::cout << "[Rank " << upcxx::rank_me() << "]"
@@ -148,21 +227,453 @@ class Worker {
     }
 
     /**
-     *
+     * Record the messages of one cycle and replay them, for iterative jobs that send the same pattern every cycle
+     * (PageRank, SpMV). Once a cycle is recorded, each sender knows the rank and buffer offset of each of its pushes,
+     * and each receiver the table slot that each buffer offset goes to. The following cycles only write the values
+     * to their offsets; receivers fetch the values and apply them by slot, so no keys are sent, hashed or looked up.
+     * Pushes are checked against the recorded keys as they are made. If a rank deviates from its plan, or a receiver
+     * adds, removes or relocates Items, the cycle falls back to keyed messages on all ranks and the next one is
+     * recorded again. Messages from a rank to itself stay keyed. Collective, call it on all ranks between cycles.
+     */
+    void enable_comm_plan(bool enabled = true) {
+        comm_plan_enabled = enabled;
+        reset_comm_plan();
+    }
+
+    /**
+     * Remember the number of messages fetched from each remote rank, for jobs that send about as much every cycle.
+     * The next cycle then fetches that many messages right away, at the same time as the actual size, instead of
+     * waiting for the size first. Only a grown buffer needs a second fetch for the rest.
+     */
+    void enable_cached_sizes(bool enabled = true) {
+        cached_sizes_enabled = enabled;
+        cached_push_size.assign(total_workers, 0);
+    }
+
+    /**
+     * Record how long each phase of a cycle takes (see CyclePhase), for the last PHASE_TIMINGS_CYCLES cycles.
+     * If a path is given, each rank writes its timings there when the Worker is destroyed, with the rank
+     * inserted before the extension ("timings.csv" becomes "timings.3.csv"). Paths ending in .json get JSON,
+     * others CSV.
+     */
+    void enable_phase_timings(const std::string& path = "") {
+        phase_timings.enable();
+        phase_timings_path = path;
+    }
+
+    /**
+     * Count the messages and bytes this rank sends to each rank, per cycle and in total
+     */
+    void enable_traffic_matrix() {
+        traffic.enable(total_workers);
+    }
+
+    /**
+     * Collect the traffic matrix of all ranks on rank 0, row-major with one row per sending rank, in messages
+     * or in bytes. Must be called by all ranks. Other ranks get an empty vector.
+     */
+    std::vector<uint64_t> gather_traffic_matrix(bool last_cycle = false, bool bytes = false) {
+        std::vector<uint64_t> messages_matrix;
+        std::vector<uint64_t> bytes_matrix;
+        gather_traffic(last_cycle, messages_matrix, bytes_matrix);
+        return bytes ? bytes_matrix : messages_matrix;
+    }
+
+    /**
+     * Gather the traffic matrix and write it from rank 0 as CSV, one line per src and dest rank.
+     * Must be called by all ranks.
+     */
+    void write_traffic_matrix(const std::string& path, bool last_cycle = false) {
+        std::vector<uint64_t> messages_matrix;
+        std::vector<uint64_t> bytes_matrix;
+        gather_traffic(last_cycle, messages_matrix, bytes_matrix);
+        if (rank_me_ != 0) {
+            return;
+        }
+
+        std::ofstream out(path);
+        if (!out) {
+            print_message("Could not open " + path + " for the traffic matrix.");
+            return;
+        }
+        traffic.write_csv(out, messages_matrix, bytes_matrix, total_workers);
+    }
+
+    /**
+     * Record a trace of cycles, their phases, barriers, rgets per peer and user spans, in the Chrome trace
+     * format. Events go to a buffer of TRACE_MAX_EVENTS allocated now. If a path is given, each rank writes
+     * its trace there when the Worker is destroyed, with the rank inserted before the extension.
+     */
+    void enable_trace(const std::string& path = "") {
+        tracer.enable();
+        trace_path = path;
+    }
+
+    /**
+     * Span of user code in the trace, e.g. from a work hook. Names must be string literals.
+     */
+    inline void trace_begin(const char* name) {
+        tracer.begin(name);
+    }
+
+    inline void trace_end(const char* name) {
+        tracer.end(name);
+    }
+
+    /**
+     * Count instructions, cycles, cache misses and branch misses per cycle phase, with perf_event_open (Linux).
+     * Reading the counters is a system call, made at every phase boundary. Returns false if the counters
+     * are not available, e.g. with a restrictive /proc/sys/kernel/perf_event_paranoid.
+     */
+    bool enable_perf_counters() {
+        bool available = perf_counters.enable();
+        if (!available && rank_me_ == 0) {
+            print_message("Performance counters are not available.");
+        }
+        return available;
+    }
+
+    /**
+     * Register a region of user code to count with perf_region_begin()/perf_region_end(). All ranks must
+     * register the same regions in the same order, so that they can be aggregated.
+     */
+    int perf_region(const std::string& name) {
+        return perf_counters.add_region(name);
+    }
+
+    inline void perf_region_begin(int region) {
+        perf_counters.begin_region(region);
+    }
+
+    inline void perf_region_end(int region) {
+        perf_counters.end_region(region);
+    }
+
+    /**
+     * Print the counters of each phase and region, as min/mean/max over ranks, and for every rank if per_rank is
+     * set. Must be called by all ranks, at the end of the job.
+     */
+    void print_perf_counters(bool per_rank = false) {
+        upcxx::dist_object<std::vector<uint64_t>> local_values(perf_counters.flatten());
+        if (rank_me_ == 0) {
+            std::vector<std::vector<uint64_t>> values;
+            for (int i = 0; i < total_workers; i++) {
+                values.push_back(local_values.fetch(i).wait());
+            }
+
+            std::size_t rows = values[0].size() / NumPerfCounters;
+            for (std::size_t row = 0; row < rows; row++) {
+                std::string name = row < NumCyclePhases ? cycle_phase_name(row) : perf_counters.region_names[row - NumCyclePhases];
+                std::ostringstream s;
+                s << "Counters " << name << ":";
+                bool counted = false;
+                for (int c = 0; c < NumPerfCounters; c++) {
+                    uint64_t min = UINT64_MAX, max = 0;
+                    double sum = 0;
+                    for (auto& rank_values : values) {
+                        uint64_t value = rank_values[row * NumPerfCounters + c];
+                        min = std::min(min, value);
+                        max = std::max(max, value);
+                        sum += value;
+                    }
+                    counted = counted || max > 0;
+                    s << " " << perf_counter_name(c) << " " << min << "/" << (uint64_t) (sum / total_workers) << "/" << max;
+                }
+                // Phases the job did not go through, or counters which were not available
+                if (!counted) {
+                    continue;
+                }
+                s << " (min/mean/max)";
+                print_message(s.str());
+
+                for (int i = 0; per_rank && i < total_workers; i++) {
+                    std::ostringstream r;
+                    r << "Counters " << name << " on rank " << i << ":";
+                    for (int c = 0; c < NumPerfCounters; c++) {
+                        r << " " << perf_counter_name(c) << " " << values[i][row * NumPerfCounters + c];
+                    }
+                    print_message(r.str());
+                }
+            }
+        }
+        // Keep the values alive until rank 0 has them
+        upcxx::barrier();
+    }
+
+    /**
+     * Load balance of the cycles recorded by the phase timings (see enable_phase_timings()), per cycle and rank.
+     * A rank counts as slow in a cycle if its work and receive time is above slow_ratio times the mean, and as
+     * a straggler if it is slow in at least min_fraction of the cycles. Must be called by all ranks, at the same
+     * cycle. The report is filled on rank 0 only.
+     */
+    LoadReport load_report(double slow_ratio = 1.25, double min_fraction = 0.5) {
+        std::vector<double> local_values;
+        for (auto& record : phase_timings.get_records()) {
+            append_load_values(local_values, record);
+        }
+        char host[256] = {};
+        gethostname(host, sizeof(host) - 1);
+
+        upcxx::dist_object<std::vector<double>> rank_values(local_values);
+        upcxx::dist_object<std::string> rank_host{std::string(host)};
+        LoadReport report;
+
+        if (rank_me_ == 0) {
+            std::vector<std::vector<double>> values;
+            std::vector<std::string> hosts;
+            for (int i = 0; i < total_workers; i++) {
+                values.push_back(rank_values.fetch(i).wait());
+                hosts.push_back(rank_host.fetch(i).wait());
+            }
+            report = build_load_report(values, slow_ratio, min_fraction);
+            report.hosts = hosts;
+        }
+        // Keep the values alive until rank 0 has them
+        upcxx::barrier();
+        return report;
+    }
+
+    /**
+     * Print the mean and worst imbalance of the recorded cycles, and the stragglers, from rank 0.
+     * Must be called by all ranks.
+     */
+    void print_load_report(double slow_ratio = 1.25, double min_fraction = 0.5) {
+        auto report = load_report(slow_ratio, min_fraction);
+        if (rank_me_ != 0 || report.cycles.empty()) {
+            return;
+        }
+
+        double work_mean = 0, recv_mean = 0, items_mean = 0, work_worst = 0, recv_worst = 0, items_worst = 0;
+        for (auto& load : report.cycles) {
+            work_mean += load.work_imbalance / report.cycles.size();
+            recv_mean += load.receive_imbalance / report.cycles.size();
+            items_mean += load.items_imbalance / report.cycles.size();
+            work_worst = std::max(work_worst, load.work_imbalance);
+            recv_worst = std::max(recv_worst, load.receive_imbalance);
+            items_worst = std::max(items_worst, load.items_imbalance);
+        }
+
+        std::ostringstream s;
+        s << "Imbalance (max/mean over ranks) in " << report.cycles.size() << " cycles: "
+          << "work " << work_mean << " (worst " << work_worst << "), "
+          << "receive " << recv_mean << " (worst " << recv_worst << "), "
+          << "items " << items_mean << " (worst " << items_worst << ").";
+        print_message(s.str());
+
+        for (int rank : report.stragglers) {
+            std::ostringstream r;
+            r << "Straggler: rank " << rank << " on " << report.hosts[rank]
+              << ", slow in " << report.slow_cycles[rank] << " of " << report.cycles.size() << " cycles.";
+            print_message(r.str());
+        }
+    }
+
+    /**
+     * Memory held by this rank: push and receive buffers in the shared segment, bookkeeping of the Worker, and
+     * per table the hash map (capacity and occupancy), item objects, columns, item lists and the bytes that
+     * items report through memory_bytes(). Walks all items of tables whose items report memory_bytes().
+     */
+    MemoryReport memory_report() {
+        MemoryReport report;
+        const std::size_t buffer_bytes = BUFFER_MAX_SIZE * sizeof(Message<TableKey_T, ItemKey_T, Msg_T>) + sizeof(std::size_t);
+        for (int i = 0; i < total_workers; i++) {
+            report.send_buffer_bytes += buffer_bytes;
+            if (!is_process_local(i)) {
+                report.recv_buffer_bytes += buffer_bytes;
+            }
+        }
+
+        report.worker_bytes = send_plan.capacity() * sizeof(std::pair<int, std::size_t>)
+            + (async_inbox.capacity() + async_remote_inbox.capacity() + async_draining.capacity())
+               * sizeof(Message<TableKey_T, ItemKey_T, Msg_T>)
+            + (push_many_ranks.capacity() + push_many_cursor.capacity() + cached_push_size.capacity()) * sizeof(std::size_t)
+            + (traffic.total_messages.capacity() + traffic.cycle_messages.capacity() + traffic.pending_messages.capacity()
+               + traffic.total_bytes.capacity() + traffic.cycle_bytes.capacity() + traffic.pending_bytes.capacity()) * sizeof(uint64_t)
+            + phase_timings.records.capacity() * sizeof(CycleTiming)
+            + tracer.events.capacity() * sizeof(TraceEvent);
+        for (auto& keys : send_plan_keys) {
+            report.worker_bytes += keys.capacity() * sizeof(std::pair<TableKey_T, ItemKey_T>);
+        }
+        for (auto& plan : recv_plan) {
+            report.worker_bytes += plan.capacity() * sizeof(PlannedSlot);
+        }
+
+        for (auto table_iterator : tables) {
+            TableMemory memory;
+            table_iterator->account_memory(memory);
+            report.tables.push_back(memory);
+        }
+        return report;
+    }
+
+    /**
+     * Print the memory report of this rank
+     */
+    void print_memory_report() {
+        auto report = memory_report();
+        std::ostringstream s;
+        s << "Memory: " << format_bytes(report.total_bytes()) << " total, "
+          << format_bytes(report.segment_bytes()) << " in shared segment (send buffers " << format_bytes(report.send_buffer_bytes)
+          << ", receive buffers " << format_bytes(report.recv_buffer_bytes) << "), "
+          << "worker " << format_bytes(report.worker_bytes) << ".";
+        print_message(s.str());
+
+        for (std::size_t t = 0; t < report.tables.size(); t++) {
+            auto& table = report.tables[t];
+            std::ostringstream r;
+            r << "Memory of table " << t << ": " << format_bytes(table.total_bytes()) << " for " << table.items << " items, "
+              << "map " << format_bytes(table.map_bytes) << " (" << table.map_occupied << " of " << table.map_slots << " slots used), "
+              << "items " << format_bytes(table.item_bytes) << ", columns " << format_bytes(table.column_bytes) << ", "
+              << "lists " << format_bytes(table.list_bytes) << ", user " << format_bytes(table.user_bytes) << ".";
+            print_message(r.str());
+        }
+    }
+
+    /**
+     * Print the memory report of rank 0 (and local roots) every interval cycles, at the end of the cycle. 0 turns it off.
+     */
+    void set_memory_summary(unsigned int interval) {
+        memory_summary_interval = interval;
+    }
+
+    /**
+     * Write the trace of this rank, to a file named as in enable_trace()
+     */
+    void write_trace(const std::string& path) {
+        std::ofstream out(rank_file_path(path, rank_me_));
+        if (!out) {
+            print_message("Could not open " + rank_file_path(path, rank_me_) + " for the trace.");
+            return;
+        }
+        tracer.write_json(out, rank_me_);
+    }
+
+    /**
+     * Write the phase timings of this rank, to a file named as in enable_phase_timings()
+     */
+    void write_phase_timings(const std::string& path) {
+        std::ofstream out(rank_file_path(path, rank_me_));
+        if (!out) {
+            print_message("Could not open " + rank_file_path(path, rank_me_) + " for phase timings.");
+            return;
+        }
+
+        if (is_json_path(path)) {
+            phase_timings.write_json(out, rank_me_);
+        } else {
+            phase_timings.write_csv(out, rank_me_);
+        }
+    }
+
+    /**
+     * Enqueue one push per destination key, all from the same source Item and to the same table.
+     * Keys are routed as a whole: the ranks of all keys are computed first (see get_partitions()), then the
+     * messages are scattered into the per-rank buffers (a counting sort), so that each buffer is looked up once.
+     * The order of messages to the same rank is kept. If vals is nullptr, all messages carry msg.value.
+     */
+    void enqueue_push_many(Message<TableKey_T, ItemKey_T, Msg_T> msg,
+                           const ItemKey_T* dest_items, const Msg_T* vals, std::size_t n) {
+        if (comm_plan_enabled || async_running) {
+            // Planned pushes are checked one by one, and async mode sends full buffers as they fill up
+            for (std::size_t i = 0; i < n; i++) {
+                msg.dest_item = dest_items[i];
+                if (vals != nullptr) {
+                    msg.value = vals[i];
+                }
+                enqueue_push_request(msg);
+            }
+            return;
+        }
+
+        push_many_ranks.resize(n);
+        push_many_cursor.assign(total_workers, 0);
+
+        get_partitions(msg.dest_table, dest_items, n, push_many_ranks.data());
+        for (std::size_t i = 0; i < n; i++) {
+            push_many_cursor[push_many_ranks[i]]++;
+        }
+
+        // Turn the counts into the first free position of each buffer
+        for (int r = 0; r < total_workers; r++) {
+            std::size_t count = push_many_cursor[r];
+            if (count == 0) {
+                continue;
+            }
+
+            std::size_t messages_total = get_messgaes_count_send(r);
+            push_many_cursor[r] = messages_total;
+            // As in enqueue_push_request, the size keeps counting past the end, so that validate_buffer_space() sees the overflow
+            set_messages_count_send(r, messages_total + count);
+
+            if (SADDLEBAG_DEBUG > 5 && messages_total + count > BUFFER_MAX_SIZE) {
+                std::cout << "[Rank " << upcxx::rank_me() << "]"
+                          << " Fatal Error: Out of space for buffers (currently set to " << BUFFER_MAX_SIZE << ")."
+                          << " Increase the buffer size, and try again."
+                          << std::endl;
+            }
+        }
+
+        for (std::size_t i = 0; i < n; i++) {
+            std::size_t dest_rank = push_many_ranks[i];
+            std::size_t position = push_many_cursor[dest_rank]++;
+            if (position < BUFFER_MAX_SIZE) {
+                auto& send_msg = my_push_buffers[dest_rank][position];
+                send_msg = msg;
+                send_msg.dest_item = dest_items[i];
+                if (vals != nullptr) {
+                    send_msg.value = vals[i];
+                }
+            }
+        }
+    }
+
+    /**
+     * Run iter cycles. With vote to halt enabled, returns early once the job is halted.
+     * Returns the number of cycles run.
      */
-    void cycle(int iter = 1, bool do_work = true, bool do_comm = true){
+    int cycle(int iter = 1, bool do_work = true, bool do_comm = true){
 
-        if (cycles_counter == 0) {
+        // Not keyed on cycles_counter, as a halted job can return before counting its first cycle
+        if (!buffers_gptr_ready) {
             create_buffers_gptr_wait();
+            buffers_gptr_ready = true;
         }
 
         for (int i = 0; i < iter; i++) {
 #if DEBUG_TIME_MEASUREMENTS
             auto start_time = std::chrono::high_resolution_clock::now();
 #endif
+            phase_timings.begin_cycle(cycles_counter);
+            tracer.begin("cycle", cycles_counter);
+            tracer.begin_laps();
+            perf_counters.begin_laps();
             // Let communication from previous cycle wrap-up
             upcxx::progress();
-            upcxx::barrier();
+            if (comm_plan_enabled) {
+                settle_comm_plan(do_comm);
+            }
+            // Count the buffers read in this cycle before the barrier, as receivers on the same node reset the sizes.
+            // Without communication they stay for the next cycle.
+            if (traffic.enabled && do_comm) {
+                record_traffic();
+            }
+            if (halt_when_idle) {
+                // The reduction doubles as the barrier
+                std::size_t pending = upcxx::reduce_all(count_pending(), upcxx::op_fast_add).wait();
+                lap_phase(PhaseBarrier);
+                if (pending == 0) {
+                    job_halted = true;
+                    if (comm_plan_enabled) {
+                        reset_comm_plan();
+                    }
+                    phase_timings.end_cycle(phase_timings.enabled ? count_items() : 0);
+                    tracer.end("cycle", cycles_counter);
+                    return i;
+                }
+            } else {
+                upcxx::barrier();
+                lap_phase(PhaseBarrier);
+            }
             std::ostringstream s;
 
             if (SADDLEBAG_DEBUG > 5 && rank_me_ == rank_n_ - 1) {
@@ -173,23 +684,32 @@ class Worker {
                 if (is_local_root()) {
                     validate_buffer_space();
                 }
+                lap_phase(PhaseLocalRecv);
 
                 if (total_nodes == 1 && UPCXX_GPTR_LOCAL_ON) {
                     apply_push_incoming_local();
                 } else {
                     apply_push_incoming_remote();
                 }
+                deliver_push_batches();
+                if (recv_plan_state == PlanRecording) {
+                    resolve_recv_plan();
+                }
+                lap_phase(PhaseLocalRecv);
 
                 // Note values before buffers are cleared (prior to work)
                 s << "Messages sent: " << messages_sent << ", recv (local): " << messages_recv_local << ", recv (remote): " << messages_recv_remote << ". "
                   << "Buffer size min: " << buffer_size_min << ", max: " << buffer_size_max << ", recommended: " << round_off(buffer_size_max) << ".";
 
                 upcxx::barrier(); // Important for everyone to finish
+                lap_phase(PhaseBarrier);
                 clear_buffers();
+                lap_phase(PhaseClear);
             }
 
             if (do_work) {
                 work();
+                lap_phase(PhaseWork);
             }
 
             if (SADDLEBAG_DEBUG > 6 && rank_me_ == 0) {
@@ -214,8 +734,209 @@ class Worker {
                           << std::endl;
             }
 
+            if (memory_summary_interval > 0 && (cycles_counter + 1) % memory_summary_interval == 0
+                && (rank_me_ == 0 || is_local_root())) {
+                print_memory_report();
+            }
+
+            phase_timings.end_cycle(phase_timings.enabled ? count_items() : 0);
+            tracer.end("cycle", cycles_counter);
             cycles_counter++;
         }
+        return iter;
+    }
+
+    /**
+     * Asynchronous execution, for delta-based algorithms on tables with active scheduling or vote to halt.
+     * Ranks do not run cycles: each rank delivers messages to its own Items right away and keeps running the
+     * Items that have pending input. Messages to another rank are sent as one RPC per buffer, once the buffer is
+     * filled to ASYNC_FLUSH_FILL, after ASYNC_FLUSH_SECONDS, or when the rank runs out of local work, and the
+     * receiver delivers them the next time it drains its inbox. No rank waits for another while it has work.
+     * Termination is detected without collectives: rank 0 collects the sent and received counts of all ranks in
+     * waves, and ends the run after two waves in a row in which all ranks were idle, reported the same counts,
+     * and had received as many messages as were sent.
+     * Collective, call it on all ranks. Returns the number of buffers this rank sent.
+     */
+    int run_async() {
+        // Sent buffers must hold keyed messages
+        bool comm_plan_before = comm_plan_enabled;
+        comm_plan_enabled = false;
+
+        async_running = true;
+        async_flushes = 0;
+        async_sent = 0;
+        async_received = 0;
+        async_idle = false;
+        async_done = false;
+        async_wave.clear();
+        async_last_wave_settled = false;
+        // No rank may send before all counters are reset
+        upcxx::barrier();
+
+        const std::size_t flush_fill = (std::size_t) (ASYNC_FLUSH_FILL * BUFFER_MAX_SIZE);
+        auto last_flush = std::chrono::high_resolution_clock::now();
+
+        while (!async_done) {
+            upcxx::progress();
+            drain_async_inbox();
+            deliver_own_messages();
+            if (count_active() > 0) {
+                work();
+            }
+
+            bool local_work = count_active() > 0 || get_messgaes_count_send(rank_me_) > 0 || !async_remote_inbox.empty();
+            std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - last_flush;
+            bool timed = elapsed.count() >= ASYNC_FLUSH_SECONDS;
+            for (int i = 0; i < total_workers; i++) {
+                std::size_t messages_total = get_messgaes_count_send(i);
+                if (i != rank_me_ && messages_total > 0 && (!local_work || timed || messages_total >= flush_fill)) {
+                    flush_async_buffer(i);
+                }
+            }
+            if (timed) {
+                last_flush = std::chrono::high_resolution_clock::now();
+            }
+
+            // Set only here, and cleared by every arriving buffer
+            async_idle = !local_work && count_pending() == 0;
+            if (rank_me_ == 0) {
+                detect_async_termination();
+            }
+        }
+
+        // The last termination messages are handled before other communication starts
+        upcxx::barrier();
+        async_running = false;
+        comm_plan_enabled = comm_plan_before;
+        if (comm_plan_enabled) {
+            reset_comm_plan();
+        }
+        job_halted = true;
+        return async_flushes;
+    }
+
+    /**
+     * Send the buffer to dest_rank as one RPC, which adds the messages to the inbox of the receiver
+     */
+    void flush_async_buffer(int dest_rank) {
+        std::size_t messages_total = valid_buffer_size(get_messgaes_count_send(dest_rank));
+        auto send_buffer = my_push_buffers[dest_rank];
+        tracer.begin("async_flush", dest_rank);
+        upcxx::rpc_ff(dest_rank,
+            [](upcxx::dist_object<Worker*>& peers, upcxx::view<Message<TableKey_T, ItemKey_T, Msg_T>> msgs) {
+                Worker* worker = *peers;
+                for (auto msg : msgs) {
+                    worker->async_remote_inbox.push_back(msg);
+                }
+                worker->async_received += msgs.size();
+                worker->async_idle = false;
+            }, *async_peers, upcxx::make_view(send_buffer, send_buffer + messages_total));
+        tracer.end("async_flush", dest_rank);
+
+        traffic.add(dest_rank, messages_total, messages_total * sizeof(Message<TableKey_T, ItemKey_T, Msg_T>));
+        async_sent += messages_total;
+        async_flushes++;
+        set_messages_count_send(dest_rank, 0);
+    }
+
+    /**
+     * Deliver the messages other ranks sent in async mode
+     */
+    void drain_async_inbox() {
+        if (async_remote_inbox.empty()) {
+            return;
+        }
+
+        // Buffers arriving meanwhile go to the emptied inbox
+        async_draining.clear();
+        async_draining.swap(async_remote_inbox);
+        for (std::size_t first = 0; first < async_draining.size(); first += BUFFER_MAX_SIZE) {
+            std::size_t messages_total = std::min(async_draining.size() - first, (std::size_t) BUFFER_MAX_SIZE);
+            messages_recv_remote += process_push_buffer(async_draining.data() + first, messages_total, rank_me_);
+        }
+        deliver_push_batches();
+    }
+
+    /**
+     * On rank 0: collect the counts of all ranks, one wave at a time, and end the run on all ranks once two waves
+     * in a row found all ranks idle with the same counts, and every sent message received. Between the two waves
+     * no rank sent or received anything, so no message was in flight and no rank had work left.
+     */
+    void detect_async_termination() {
+        if (async_wave.empty()) {
+            // A wave can only succeed while rank 0 is idle itself
+            if (async_idle) {
+                for (int i = 0; i < total_workers; i++) {
+                    async_wave.push_back(upcxx::rpc(i, [](upcxx::dist_object<Worker*>& peers) {
+                        Worker* worker = *peers;
+                        return AsyncCounts{worker->async_sent, worker->async_received, worker->async_idle ? 1u : 0u};
+                    }, *async_peers));
+                }
+            }
+            return;
+        }
+
+        for (auto& fut : async_wave) {
+            if (!fut.ready()) {
+                return;
+            }
+        }
+
+        AsyncCounts total{0, 0, 1};
+        for (auto& fut : async_wave) {
+            AsyncCounts counts = fut.wait();
+            total.sent += counts.sent;
+            total.received += counts.received;
+            total.idle &= counts.idle;
+        }
+        async_wave.clear();
+
+        bool settled = total.idle && total.sent == total.received;
+        if (settled && async_last_wave_settled && total.sent == async_last_wave.sent) {
+            for (int i = 0; i < total_workers; i++) {
+                if (i != rank_me_) {
+                    upcxx::rpc_ff(i, [](upcxx::dist_object<Worker*>& peers) {
+                        (*peers)->async_done = true;
+                    }, *async_peers);
+                }
+            }
+            async_done = true;
+        }
+        async_last_wave_settled = settled;
+        async_last_wave = total;
+    }
+
+    /**
+     * Items held by this rank, in all tables
+     */
+    std::size_t count_items() {
+        std::size_t items = 0;
+        for (auto table_iterator : tables) {
+            items += table_iterator->count_items();
+        }
+        return items;
+    }
+
+    /**
+     * Items that would run in the next work(), in all tables
+     */
+    std::size_t count_active() {
+        std::size_t active = 0;
+        for (auto table_iterator : tables) {
+            active += table_iterator->count_active();
+        }
+        return active;
+    }
+
+    /**
+     * Work left for the next cycle on this rank: messages waiting to be sent, and Items that would run
+     */
+    std::size_t count_pending() {
+        std::size_t pending = count_active();
+        for (int i = 0; i < total_workers; i++) {
+            pending += valid_buffer_size(get_messgaes_count_send(i));
+        }
+        return pending;
     }
 
     /*******************************************
@@ -251,26 +972,16 @@ class Worker {
         if (get_partition(table_key, item_key) == rank_me_) {
             assert(table_key < tables.size());
             auto target_table = tables[table_key];
-            auto target_map = target_table->get_items();
-            auto it = target_map->find(item_key);
+            auto existing = target_table->find_item(item_key);
 
-            if (it == target_map->end()) {
+            if (existing == nullptr) {
                 if (is_create) {
-                    //create new object of ObjectType
-                    auto new_obj = new ObjectType<TableKey_T, ItemKey_T, Msg_T>();
-                    new_obj->myTableKey = table_key;
-                    new_obj->myItemKey = item_key;
-                    new_obj->worker = this;
-                    new_obj->on_create();
-                    new_obj->refresh();
-
-#if ROBIN_HASH
-                    target_map->insert(item_key, new_obj);
-#else
-                    target_map->insert({item_key, new_obj});
-#endif
+                    //create new object of ObjectType, from the table's allocator
+                    auto new_obj = static_cast<ObjectType<TableKey_T, ItemKey_T, Msg_T>*>(
+                        target_table->add_new_item(item_key));
 
-                    status = CREATED_NEW_LOCAL;
+                    // The table may reject new Items (frozen, or a key outside its range)
+                    status = new_obj != nullptr ? CREATED_NEW_LOCAL : IGNORED_NEW_LOCAL;
                     return new_obj;
                 }
 
@@ -278,8 +989,8 @@ class Worker {
                 return nullptr;
             }
 
-            auto obj = reinterpret_cast<ObjectType<TableKey_T, ItemKey_T, Msg_T>*>((*it).second);
-            obj->refresh();
+            auto obj = static_cast<ObjectType<TableKey_T, ItemKey_T, Msg_T>*>(existing);
+            target_table->refresh_item(existing);
             status = FOUND_EXISTING_LOCAL;
             return obj;
         }
@@ -301,6 +1012,58 @@ class Worker {
         return nullptr;
     }
 
+    /**
+     * Remove a local Item from its table right away. Returns false if the Item was not found on this rank.
+     * Called from the work hooks of the same table, the Item is released once all hooks of the table have run.
+     */
+    bool remove_item(TableKey_T table_key, ItemKey_T item_key) {
+        assert(table_key < tables.size());
+        if (get_partition(table_key, item_key) != rank_me_) {
+            return false;
+        }
+        return tables[table_key]->remove_item(item_key);
+    }
+
+    /**
+     * Enqueue a request to remove an Item, which its owner applies when the request is received
+     */
+    void enqueue_remove_request(TableKey_T table_key, ItemKey_T item_key) {
+        Message<TableKey_T, ItemKey_T, Msg_T> msg;
+        msg.dest_table = table_key;
+        msg.dest_item = item_key;
+        msg.src_table = table_key;
+        msg.src_item = item_key;
+        msg.value = Msg_T();
+        msg.kind = RemoveMessage;
+
+        enqueue_push_request(msg);
+    }
+
+    /**
+     * Insert Items for many keys at once. Keys owned by other ranks, or already present, are skipped.
+     * Returns the number of Items created.
+     */
+    template<template<typename, typename, typename> class ObjectType>
+    std::size_t add_items(TableKey_T table_key, const std::vector<ItemKey_T>& item_keys) {
+        assert(table_key < tables.size());
+        auto target_table = tables[table_key];
+
+        std::vector<ItemKey_T> new_keys;
+        new_keys.reserve(item_keys.size());
+        for (auto item_key : item_keys) {
+            if (get_partition(table_key, item_key) == rank_me_ && target_table->find_item(item_key) == nullptr) {
+                new_keys.push_back(item_key);
+            }
+        }
+
+        // Duplicate keys in the input are only created once
+        std::sort(new_keys.begin(), new_keys.end());
+        new_keys.erase(std::unique(new_keys.begin(), new_keys.end()), new_keys.end());
+
+        target_table->add_new_items(new_keys);
+        return new_keys.size();
+    }
+
     /**
      *
      */
@@ -308,11 +1071,97 @@ class Worker {
         sending_mode = mode;
     }
 
+    /**
+     * With active scheduling, work() runs only the Items of a table that received a message in this cycle,
+     * or called activate() in the previous one, so that a cycle costs as much as the frontier of the job.
+     * All Items are active in the first cycle after enabling it.
+     */
+    void set_active_scheduling(TableKey_T table_key, bool enabled = true) {
+        assert(table_key < tables.size());
+        tables[table_key]->active_scheduling = enabled;
+        tables[table_key]->keep_active = false;
+        if (enabled) {
+            tables[table_key]->activate_all();
+        }
+    }
+
+    /**
+     * Pregel-style scheduling: Items of the table run every cycle until they call vote_to_halt(), and wake up
+     * again when a message arrives. cycle() then stops on its own once every Item is halted and no message is
+     * left to deliver, on all ranks.
+     */
+    void enable_vote_to_halt(TableKey_T table_key) {
+        assert(table_key < tables.size());
+        tables[table_key]->active_scheduling = true;
+        tables[table_key]->keep_active = true;
+        tables[table_key]->activate_all();
+        halt_when_idle = true;
+    }
+
+    /**
+     *
+     */
+    void halt_item(TableKey_T table_key, std::size_t slot) {
+        assert(table_key < tables.size());
+        if (tables[table_key]->keep_active) {
+            tables[table_key]->halt_slot(slot);
+        }
+    }
+
+    /**
+     * True once cycle() stopped because all Items voted to halt
+     */
+    bool is_halted() const {
+        return job_halted;
+    }
+
+    /**
+     * Delta-stepping style scheduling: active Items of the table run in buckets of width delta by their priority(),
+     * lowest bucket first. After each bucket, messages this rank sent to itself are delivered right away, and the
+     * Items they reach join the remaining buckets of the same cycle, so that later relaxations are not wasted.
+     * Messages to other ranks are exchanged at the end of the cycle as usual.
+     */
+    void set_priority_scheduling(TableKey_T table_key, double delta) {
+        assert(table_key < tables.size());
+        assert(delta > 0);
+        set_active_scheduling(table_key, true);
+        tables[table_key]->priority_delta = delta;
+    }
+
+    /**
+     * Run the work hooks of the Item in slot in the next cycle, for tables with active scheduling
+     */
+    void activate_item(TableKey_T table_key, std::size_t slot) {
+        assert(table_key < tables.size());
+        if (tables[table_key]->active_scheduling) {
+            tables[table_key]->activate_slot(slot);
+        }
+    }
+
+    /**
+     * Freeze the local part of a table once its item set no longer changes (typically after loading).
+     * Items are relocated in key order and found through a compact sorted array, which makes lookups of
+     * received messages cheaper and frees the hash map. Pointers to the Items of the table are no longer
+     * valid afterwards. Adding or removing Items is an error until the table is thawed.
+     */
+    void freeze_table(TableKey_T table_key) {
+        assert(table_key < tables.size());
+        tables[table_key]->freeze();
+    }
+
+    /**
+     * Move the Items of a frozen table back into a hash map, so that Items can be added and removed again
+     */
+    void thaw_table(TableKey_T table_key) {
+        assert(table_key < tables.size());
+        tables[table_key]->thaw();
+    }
+
     /**
      * Return iterator to item-map in which every item is cast to derived item type
      */
     template<template<typename, typename, typename> class ObjectType>
-    Robin_Map<ItemKey_T, ObjectType<TableKey_T, ItemKey_T, Msg_T>*> iterate_table(TableKey_T table_key) {
+    ItemMap<ItemKey_T, ObjectType<TableKey_T, ItemKey_T, Msg_T>*> iterate_table(TableKey_T table_key) {
         assert(NULL); // TODO: Fix implementation
 
         // TableContainerBase<TableKey_T, ItemKey_T, Msg_T>* base_table = tables[table_key];
@@ -338,6 +1187,83 @@ class Worker {
     std::vector< Message<TableKey_T, ItemKey_T, Msg_T>* > their_local_push_buffers;
     std::vector<upcxx::future< upcxx::global_ptr<Message<TableKey_T, ItemKey_T, Msg_T>> >> fetch_futures_msgs;
 
+    // Communication plan (see enable_comm_plan()). The sender keeps the rank and buffer offset of each push of the
+    // recorded cycle, in order, and the keys at each offset of each send buffer. The receiver keeps the table slot
+    // reached by each offset of the buffer from each rank.
+    struct PlannedSlot {
+        TableKey_T table;
+        ItemKey_T key;
+        std::size_t slot;
+    };
+    static const std::size_t NO_SLOT = (std::size_t) -1;
+    bool comm_plan_enabled = false;
+    CommPlanState send_plan_state = PlanRecording;
+    CommPlanState recv_plan_state = PlanOff;
+    // Set once the pushes of this cycle no longer follow the plan, or can not be recorded
+    bool send_plan_broken = false;
+    std::size_t send_plan_cursor = 0;
+    std::vector<std::pair<int, std::size_t>> send_plan;
+    std::vector<std::vector<std::pair<TableKey_T, ItemKey_T>>> send_plan_keys;
+    std::vector<std::vector<PlannedSlot>> recv_plan;
+    // Layout versions of the tables when the receiving plan was resolved
+    std::size_t recv_plan_layout = 0;
+
+    // cycle() stops once no rank has pending work, set when a table uses vote to halt
+    bool halt_when_idle = false;
+    bool job_halted = false;
+
+    // Number of messages received from each rank in the last cycle, when sizes are cached
+    bool cached_sizes_enabled = false;
+    std::vector<std::size_t> cached_push_size;
+    // Exchanges so far (wrapping), published with each buffer size so that receivers can tell a size of this
+    // exchange from one of an earlier one. All ranks count the same.
+    std::size_t send_generation = 0;
+
+    // Messages sent to each rank, when the traffic matrix is enabled
+    TrafficMatrix traffic;
+
+    // Time per phase of the recent cycles, written to phase_timings_path at shutdown if set
+    PhaseTimings phase_timings;
+    std::string phase_timings_path;
+
+    // Print the memory report every this many cycles, 0 for never
+    unsigned int memory_summary_interval = 0;
+
+    // Hardware counters per phase and user region, when enabled
+    PhaseCounters perf_counters;
+
+    // Trace events, written to trace_path at shutdown if set
+    Tracer tracer;
+    std::string trace_path;
+
+    // Messages this rank sent to itself, while they are delivered early (async mode, priority scheduling)
+    std::vector<Message<TableKey_T, ItemKey_T, Msg_T>> async_inbox;
+
+    // Async mode (see run_async()). Buffers from other ranks arrive in async_remote_inbox, and are delivered from
+    // async_draining. The counts are of messages to and from other ranks.
+    struct AsyncCounts {
+        uint64_t sent;
+        uint64_t received;
+        unsigned int idle;
+    };
+    upcxx::dist_object<Worker*>* async_peers = nullptr;
+    bool async_running = false;
+    int async_flushes = 0;
+    std::vector<Message<TableKey_T, ItemKey_T, Msg_T>> async_remote_inbox;
+    std::vector<Message<TableKey_T, ItemKey_T, Msg_T>> async_draining;
+    uint64_t async_sent = 0;
+    uint64_t async_received = 0;
+    bool async_idle = false;
+    bool async_done = false;
+    // Termination waves, on rank 0
+    std::vector<upcxx::future<AsyncCounts>> async_wave;
+    AsyncCounts async_last_wave = {0, 0, 0};
+    bool async_last_wave_settled = false;
+
+    // Scratch space of enqueue_push_many(), kept between calls
+    std::vector<std::size_t> push_many_ranks;
+    std::vector<std::size_t> push_many_cursor;
+
     std::vector< upcxx::future<std::size_t> > rget_futures_size;
     std::vector< upcxx::future<> > rget_futures_msgs;
     std::vector< upcxx::global_ptr<std::size_t> > their_remote_push_size_g;
@@ -360,6 +1286,9 @@ class Worker {
     int W; // Total nodes
     int M; // Maximum number of messages between two processes
 
+    // For computing key % total_workers in get_partitions()
+    uint64_t partition_multiplier = 0;
+
     std::vector<bool> proc_local;
     std::vector<std::size_t> rank_in_local;
     std::vector<std::size_t> rank_in_world;
@@ -383,6 +1312,7 @@ class Worker {
         W = total_nodes;
         M = BUFFER_MAX_SIZE;
         my_local_coord = -1;
+        partition_multiplier = fastmod_multiplier(total_workers);
 
         proc_local.reserve(total_workers);
         rank_in_local.reserve(total_workers);
@@ -485,7 +1415,8 @@ class Worker {
             std::cout << "[Rank " << rank_me_ << "] "
                       << "FATAL ERROR: Out of memory with " << rank_n_
                       << " processes for buffer size of " << BUFFER_MAX_SIZE
-                      << " (" << ba.what() << ")." << std::endl;
+                      << " (" << ba.what() << "). Buffers need "
+                      << format_bytes(memory_report().segment_bytes()) << " of shared segment per process." << std::endl;
             error = ERROR_OUT_OF_MEMORY;
             exit(0);
         }
@@ -500,9 +1431,10 @@ class Worker {
         assert(my_push_size_g.size() == total_workers);
         assert(my_push_buffers_g.size() == total_workers);
 
+        // Rank i keeps its buffer for this rank in the dist_object at position rank_me_
         for (int i = 0; i < total_workers; i++) {
-            fetch_futures_size.push_back(my_push_size_g.at(i)->fetch(i));
-            fetch_futures_msgs.push_back(my_push_buffers_g.at(i)->fetch(i));
+            fetch_futures_size.push_back(my_push_size_g.at(rank_me_)->fetch(i));
+            fetch_futures_msgs.push_back(my_push_buffers_g.at(rank_me_)->fetch(i));
             progress(i);
         }
     }
@@ -566,8 +1498,10 @@ class Worker {
         buffer_size_min = 0;
         buffer_size_max = 0;
 
+        // Sizes published from now on belong to the next exchange
+        send_generation = (send_generation + 1) & ((std::size_t(1) << (64 - BUFFER_SIZE_COUNT_BITS)) - 1);
         for (int i = 0; i < total_workers; i++) {
-            *(my_push_buffers_size.at(i)) = 0;
+            set_messages_count_send(i, 0);
 
             if (!is_process_local(i)) {
                 *(their_remote_push_size.at(i)) = 0;
@@ -584,18 +1518,38 @@ class Worker {
      * Delete and release memory from buffers
      */
     void destroy_buffers() {
-        for (auto buf : their_remote_push_buffers) {
-            if (buf != nullptr) {
-                delete[] buf;
+        // Other ranks may still read these buffers until they are done with their last cycle
+        upcxx::barrier();
+
+        for (int i = 0; i < (int) my_push_size_g.size(); i++) {
+            upcxx::delete_(**my_push_size_g[i]);
+            delete my_push_size_g[i];
+        }
+        for (int i = 0; i < (int) my_push_buffers_g.size(); i++) {
+            upcxx::delete_array(**my_push_buffers_g[i]);
+            delete my_push_buffers_g[i];
+        }
+        for (int i = 0; i < (int) their_remote_push_size_g.size(); i++) {
+            if (!their_remote_push_size_g[i].is_null()) {
+                upcxx::delete_(their_remote_push_size_g[i]);
+            }
+            if (!their_remote_push_buffers_g[i].is_null()) {
+                upcxx::delete_array(their_remote_push_buffers_g[i]);
             }
         }
 
-        // TODO: Delete respective to any new_ calls
-        // // delete my_push_buffers_g;
-        // // upcxx::delete_array(my_push_buffers_g);
-        // Delete related to
-        // // their_remote_push_size_g
-        // // their_remote_push_buffers_g
+        my_push_size_g.clear();
+        my_push_buffers_g.clear();
+        my_push_buffers_size.clear();
+        my_push_buffers.clear();
+        their_push_size_g.clear();
+        their_push_buffers_g.clear();
+        their_local_push_size.clear();
+        their_local_push_buffers.clear();
+        their_remote_push_size_g.clear();
+        their_remote_push_buffers_g.clear();
+        their_remote_push_size.clear();
+        their_remote_push_buffers.clear();
     }
 
     /**
@@ -608,17 +1562,99 @@ class Worker {
         }
     }
 
+    /**
+     * Delete the tables, after their items were released
+     */
+    void destroy_tables() {
+        for (auto table_iterator : tables) {
+            delete table_iterator;
+        }
+        tables.clear();
+        total_tables = 0;
+    }
+
     /**
      *
      */
     void work() {
         for (auto table_iterator : tables) {
-            for (auto obj_iterator : (*(table_iterator->get_items()))) {
-                obj_iterator.second->before_work();
-                obj_iterator.second->do_work();
-                obj_iterator.second->finishing_work();
+            if (table_iterator->active_scheduling && table_iterator->priority_delta > 0) {
+                work_by_priority(table_iterator);
+            } else {
+                table_iterator->work();
+            }
+        }
+    }
+
+    /**
+     * Run the active Items of a table bucket by bucket, with a sub-cycle of local delivery after each bucket
+     */
+    void work_by_priority(TableContainerBase<TableKey_T, ItemKey_T, Msg_T>* table) {
+        table->start_buckets();
+
+        long bucket;
+        while (table->lowest_bucket(bucket)) {
+            table->run_bucket(bucket);
+
+            table->join_running(true);
+            deliver_own_messages();
+            table->join_running(false);
+        }
+    }
+
+    /**
+     * End of a cycle phase, for phase timings, the trace and performance counters
+     */
+    inline void lap_phase(CyclePhase phase) {
+        phase_timings.lap(phase);
+        tracer.lap(phase);
+        perf_counters.lap(phase);
+    }
+
+    /**
+     * Add the messages in the send buffers to the traffic matrix, which completes the row of the cycle.
+     * Bytes are what the receivers read: whole messages, or only values in replayed cycles.
+     */
+    void record_traffic() {
+        const std::size_t message_bytes = sizeof(Message<TableKey_T, ItemKey_T, Msg_T>);
+        for (int i = 0; i < total_workers; i++) {
+            std::size_t messages_total = valid_buffer_size(get_messgaes_count_send(i));
+            std::size_t units = i == rank_me_ ? messages_total : fetch_count(messages_total);
+            traffic.add(i, messages_total, units * message_bytes);
+        }
+        traffic.end_cycle();
+    }
+
+    /**
+     * Rows of the traffic matrix of all ranks, on rank 0
+     */
+    void gather_traffic(bool last_cycle, std::vector<uint64_t>& messages, std::vector<uint64_t>& bytes) {
+        upcxx::dist_object<std::vector<uint64_t>> rows(traffic.row(last_cycle));
+
+        if (rank_me_ == 0) {
+            messages.assign((std::size_t) total_workers * total_workers, 0);
+            bytes.assign((std::size_t) total_workers * total_workers, 0);
+            for (int i = 0; i < total_workers; i++) {
+                std::vector<uint64_t> row = rows.fetch(i).wait();
+                std::copy(row.begin(), row.begin() + total_workers, messages.begin() + (std::size_t) i * total_workers);
+                std::copy(row.begin() + total_workers, row.end(), bytes.begin() + (std::size_t) i * total_workers);
             }
         }
+        // Keep the rows alive until rank 0 has them
+        upcxx::barrier();
+    }
+
+    /**
+     * Deliver the messages this rank sent to itself right away, instead of in the next cycle
+     */
+    void deliver_own_messages() {
+        // Copy the messages out first, as delivering them may push new ones to this rank
+        std::size_t messages_total = valid_buffer_size(get_messgaes_count_send(rank_me_));
+        traffic.add(rank_me_, messages_total, messages_total * sizeof(Message<TableKey_T, ItemKey_T, Msg_T>));
+        async_inbox.assign(my_push_buffers[rank_me_], my_push_buffers[rank_me_] + messages_total);
+        set_messages_count_send(rank_me_, 0);
+        process_push_buffer(async_inbox.data(), messages_total, rank_me_);
+        deliver_push_batches();
     }
 
     /**
@@ -630,12 +1666,13 @@ class Worker {
                 auto messages_total = valid_buffer_size(get_messgaes_count_recv(i));
                 auto recv_buffer = their_local_push_buffers.at(i);
                 if (messages_total > 0) {
-                    messages_recv_local += process_push_buffer(recv_buffer, messages_total);
+                    messages_recv_local += process_push_buffer(recv_buffer, messages_total, i);
                 }
                 *(their_local_push_size.at(i)) = 0;
             }
             progress(i);
         }
+        lap_phase(PhaseLocalRecv);
 
         // How many messages I enqueued in my buffers?
         if (SADDLEBAG_DEBUG > 0 && rank_me_ == 0) {
@@ -666,38 +1703,70 @@ class Worker {
                 upcxx::future<std::size_t> fut;
                 rget_futures_size.push_back(fut);
             } else {
+                tracer.begin_async("size_rget", i);
                 auto fut = upcxx::rget(their_push_size_g.at(i));
                 rget_futures_size.push_back(fut);
             }
+
+            // With cached sizes, fetch as many messages as in the last cycle right away, together with the size
+            if (cached_sizes_enabled && !is_process_local(i) && cached_push_size.at(i) > 0) {
+                tracer.begin_async("buffer_rget", i);
+                upcxx::future<> fut = upcxx::rget(their_push_buffers_g.at(i),
+                            their_remote_push_buffers.at(i),
+                            fetch_count(cached_push_size.at(i)));
+                rget_futures_msgs.push_back(fut);
+            } else {
+                rget_futures_msgs.push_back(upcxx::make_future());
+            }
             progress(i);
         }
         assert(rget_futures_size.size() == total_workers);
+        lap_phase(PhaseSizeRget);
 
         // Step 2: Meanwhile, process messages in my own buffer for myself
         messages_total = valid_buffer_size(get_messgaes_count_recv(rank_me_));
         recv_buffer = their_local_push_buffers.at(rank_me_);
-        messages_recv_local += process_push_buffer(recv_buffer, messages_total);
+        messages_recv_local += process_push_buffer(recv_buffer, messages_total, rank_me_);
         *(their_local_push_size.at(rank_me_)) = 0;
+        lap_phase(PhaseLocalRecv);
 
         // Step 3a: Wait for size values
-        // Step 3b: Send out rget requests for buffers
+        // Step 3b: Send out rget requests for buffers, or only for what the cached size did not cover
         for (int i = 0; i < total_workers; i++) {
-            if (is_process_local(i)) {
-                upcxx::future<> fut;
-                rget_futures_msgs.push_back(fut);
-            } else {
-                *(their_remote_push_size.at(i)) = rget_futures_size.at(i).wait();
+            if (!is_process_local(i)) {
+                std::size_t size_word = rget_futures_size.at(i).wait();
+                std::size_t messages_fetched = cached_sizes_enabled ? cached_push_size.at(i) : 0;
+                if (messages_fetched == 0) {
+                    tracer.begin_async("buffer_rget", i);
+                }
+                // A size of an earlier exchange means the cached fetch may hold old messages too, so fetch again
+                while (buffer_size_generation(size_word) != send_generation) {
+                    rget_futures_msgs.at(i).wait();
+                    messages_fetched = 0;
+                    size_word = upcxx::rget(their_push_size_g.at(i)).wait();
+                }
+                tracer.end_async("size_rget", i);
+                *(their_remote_push_size.at(i)) = buffer_size_count(size_word);
                 messages_total = valid_buffer_size(*(their_remote_push_size.at(i)));
-                upcxx::future<> fut = upcxx::rget(their_push_buffers_g.at(i),
-                            their_remote_push_buffers.at(i),
-                            messages_total);
-                rget_futures_msgs.push_back(fut);
-                // TODO [Enhancement]: Use upcxx::then() to combine futures!
+                messages_fetched = std::min(messages_fetched, messages_total);
+
+                if (messages_total > messages_fetched || !cached_sizes_enabled) {
+                    // The rest is fetched alongside the cached part, and both complete as one future
+                    upcxx::future<> fut = upcxx::rget(their_push_buffers_g.at(i) + fetch_count(messages_fetched),
+                                their_remote_push_buffers.at(i) + fetch_count(messages_fetched),
+                                fetch_count(messages_total) - fetch_count(messages_fetched));
+                    rget_futures_msgs.at(i) = upcxx::when_all(rget_futures_msgs.at(i), fut);
+                }
+
+                if (cached_sizes_enabled) {
+                    cached_push_size.at(i) = messages_total;
+                }
             }
             progress(i);
         }
         // TODO [Enhancement]: Use upcxx::when_all() to combine all futures!
         assert(rget_futures_msgs.size() == total_workers);
+        lap_phase(PhaseSizeRget);
 
         // Step 4: Meanwhile, process messages from local processes
         apply_push_incoming_local();
@@ -706,9 +1775,12 @@ class Worker {
         for (int i = 0; i < total_workers; i++) {
             if (!is_process_local(i)) {
                 rget_futures_msgs.at(i).wait();
+                tracer.end_async("buffer_rget", i);
+                lap_phase(PhaseBufferRget);
                 messages_total = valid_buffer_size(*(their_remote_push_size.at(i)));
                 recv_buffer = their_remote_push_buffers.at(i);
-                messages_recv_remote += process_push_buffer(recv_buffer, messages_total);
+                messages_recv_remote += process_push_buffer(recv_buffer, messages_total, i);
+                lap_phase(PhaseRemoteRecv);
             }
             progress(i);
         }
@@ -724,18 +1796,230 @@ class Worker {
     /**
      *
      */
-    int process_push_buffer(Message<TableKey_T, ItemKey_T, Msg_T>* recv_buffer, std::size_t messages_total = 0) {
+    int process_push_buffer(Message<TableKey_T, ItemKey_T, Msg_T>* recv_buffer, std::size_t messages_total = 0, int src_rank = 0) {
         messages_total = valid_buffer_size(messages_total);
+        if (recv_plan_state == PlanReplaying && src_rank != rank_me_) {
+            return apply_planned_values(recv_buffer, messages_total, src_rank);
+        }
 
         for (int i = 0; i < messages_total; i++) {
             auto msg = recv_buffer[i];
-            tables[msg.dest_table]->apply_push_to_item(msg, !DEBUG_DISABLE_CREATE_ON_PUSH);
+            if (msg.kind == RemoveMessage) {
+                if (tables[msg.dest_table]->batch_pushes) {
+                    tables[msg.dest_table]->deliver_staged_pushes(msg.dest_item, !DEBUG_DISABLE_CREATE_ON_PUSH);
+                }
+                tables[msg.dest_table]->remove_item(msg.dest_item);
+            } else if (tables[msg.dest_table]->batch_pushes) {
+                tables[msg.dest_table]->stage_push(msg);
+            } else {
+                tables[msg.dest_table]->apply_push_to_item(msg, !DEBUG_DISABLE_CREATE_ON_PUSH);
+            }
+            if (recv_plan_state == PlanRecording && src_rank != rank_me_) {
+                recv_plan[src_rank].push_back(PlannedSlot{msg.dest_table, msg.dest_item, NO_SLOT});
+            }
             progress(i);
         }
 
         return messages_total;
     }
 
+    /**
+     * Write a planned push as value only, at the buffer offset it had in the recorded cycle.
+     * Returns false if the push is to be sent as keyed message instead.
+     */
+    bool replay_push(Message<TableKey_T, ItemKey_T, Msg_T> const& msg) {
+        if (send_plan_state != PlanReplaying || send_plan_broken) {
+            return false;
+        }
+
+        std::size_t index = send_plan_cursor++;
+        if (index >= send_plan.size() || msg.kind != PushMessage) {
+            break_send_plan();
+            return false;
+        }
+        int dest_rank = send_plan[index].first;
+        std::size_t position = send_plan[index].second;
+        auto& key = send_plan_keys[dest_rank][position];
+        if (key.first != msg.dest_table || key.second != msg.dest_item) {
+            break_send_plan();
+            return false;
+        }
+
+        if (dest_rank == rank_me_) {
+            my_push_buffers[dest_rank][position] = msg;
+        } else {
+            write_plan_value(my_push_buffers[dest_rank], position, msg.value);
+        }
+        set_messages_count_send(dest_rank, position + 1);
+        return true;
+    }
+
+    /**
+     * Add a keyed push to the plan of the cycle being recorded
+     */
+    void record_push(Message<TableKey_T, ItemKey_T, Msg_T> const& msg, int dest_rank, std::size_t position) {
+        if (send_plan_state != PlanRecording || send_plan_broken) {
+            return;
+        }
+
+        auto& keys = send_plan_keys[dest_rank];
+        // Only a cycle of pushes into emptied buffers can be replayed
+        if (msg.kind != PushMessage || position != keys.size()) {
+            send_plan_broken = true;
+            return;
+        }
+        send_plan.emplace_back(dest_rank, position);
+        keys.emplace_back(msg.dest_table, msg.dest_item);
+    }
+
+    /**
+     * Turn the values written so far in this cycle back into keyed messages, once the pushes deviate from the plan
+     */
+    void break_send_plan() {
+        send_plan_broken = true;
+        for (int r = 0; r < total_workers; r++) {
+            if (r == rank_me_) {
+                continue;
+            }
+
+            auto buffer = my_push_buffers[r];
+            auto& keys = send_plan_keys[r];
+            // Back to front, as message i overlaps the values from i on
+            for (std::size_t i = valid_buffer_size(get_messgaes_count_send(r)); i-- > 0;) {
+                Message<TableKey_T, ItemKey_T, Msg_T> msg;
+                msg.value = read_plan_value(buffer, i);
+                msg.dest_table = msg.src_table = keys[i].first;
+                msg.dest_item = msg.src_item = keys[i].second;
+                msg.kind = PushMessage;
+                buffer[i] = msg;
+            }
+        }
+    }
+
+    /**
+     * Agree on all ranks whether the messages of the cycle that just ended follow the plan, before any buffer is read.
+     * If they do, receivers apply the values by slot. Otherwise the messages are keyed, and the next cycle is recorded.
+     * A recorded cycle becomes the plan if no rank ran out of buffer space or sent anything but pushes.
+     */
+    void settle_comm_plan(bool do_comm) {
+        bool ok = do_comm && !send_plan_broken;
+        if (send_plan_state == PlanReplaying) {
+            ok = ok && send_plan_cursor == send_plan.size() && recv_plan_layout == count_layout_changes();
+        }
+        bool all_ok = upcxx::reduce_all(ok ? 1 : 0, upcxx::op_fast_min).wait() == 1;
+
+        if (all_ok) {
+            recv_plan_state = send_plan_state;
+            send_plan_state = PlanReplaying;
+            if (recv_plan_state == PlanRecording) {
+                for (auto& plan : recv_plan) {
+                    plan.clear();
+                }
+            }
+        } else {
+            if (send_plan_state == PlanReplaying && !send_plan_broken) {
+                break_send_plan();
+            }
+            recv_plan_state = PlanOff;
+            send_plan_state = PlanRecording;
+            send_plan.clear();
+            for (auto& keys : send_plan_keys) {
+                keys.clear();
+            }
+        }
+        send_plan_broken = false;
+        send_plan_cursor = 0;
+    }
+
+    /**
+     * Forget the plan, and record the next cycle
+     */
+    void reset_comm_plan() {
+        send_plan_state = PlanRecording;
+        recv_plan_state = PlanOff;
+        send_plan_broken = false;
+        send_plan_cursor = 0;
+        send_plan.clear();
+        send_plan_keys.assign(total_workers, std::vector<std::pair<TableKey_T, ItemKey_T>>());
+        recv_plan.assign(total_workers, std::vector<PlannedSlot>());
+    }
+
+    /**
+     * Look up the slots of the Items that the recorded cycle reached, once all of its messages were delivered
+     */
+    void resolve_recv_plan() {
+        for (auto& plan : recv_plan) {
+            for (auto& entry : plan) {
+                auto obj = tables[entry.table]->find_item(entry.key);
+                entry.slot = (obj != nullptr) ? tables[entry.table]->slot_of(obj) : NO_SLOT;
+            }
+        }
+        recv_plan_layout = count_layout_changes();
+    }
+
+    /**
+     * Deliver a buffer of values from src_rank, each to the slot that its offset reached in the recorded cycle
+     */
+    std::size_t apply_planned_values(Message<TableKey_T, ItemKey_T, Msg_T>* recv_buffer, std::size_t messages_total, int src_rank) {
+        auto& plan = recv_plan[src_rank];
+        assert(messages_total <= plan.size());
+
+        for (std::size_t i = 0; i < messages_total; i++) {
+            auto& entry = plan[i];
+            if (entry.slot != NO_SLOT) {
+                tables[entry.table]->push_to_slot(entry.slot, read_plan_value(recv_buffer, i));
+            }
+            progress(i);
+        }
+        return messages_total;
+    }
+
+    /**
+     * Changes to the slots of Items in all tables, see TableContainerBase::layout_version
+     */
+    std::size_t count_layout_changes() {
+        std::size_t changes = 0;
+        for (auto table_iterator : tables) {
+            changes += table_iterator->layout_version;
+        }
+        return changes;
+    }
+
+    /**
+     * Messages to fetch from a remote rank that sent messages_total, which are only values in replayed cycles
+     */
+    inline std::size_t fetch_count(std::size_t messages_total) {
+        if (recv_plan_state != PlanReplaying) {
+            return messages_total;
+        }
+        const std::size_t message_bytes = sizeof(Message<TableKey_T, ItemKey_T, Msg_T>);
+        return (messages_total * sizeof(Msg_T) + message_bytes - 1) / message_bytes;
+    }
+
+    /**
+     * Values of replayed cycles are packed from the start of the buffer
+     */
+    static inline void write_plan_value(Message<TableKey_T, ItemKey_T, Msg_T>* buffer, std::size_t i, Msg_T const& value) {
+        std::memcpy(reinterpret_cast<char*>(buffer) + i * sizeof(Msg_T), &value, sizeof(Msg_T));
+    }
+
+    static inline Msg_T read_plan_value(const Message<TableKey_T, ItemKey_T, Msg_T>* buffer, std::size_t i) {
+        Msg_T value;
+        std::memcpy(&value, reinterpret_cast<const char*>(buffer) + i * sizeof(Msg_T), sizeof(Msg_T));
+        return value;
+    }
+
+    /**
+     * Deliver the pushes which batching tables collected from all buffers of this cycle
+     */
+    void deliver_push_batches() {
+        for (auto table_iterator : tables) {
+            if (table_iterator->batch_pushes) {
+                table_iterator->deliver_staged_pushes(!DEBUG_DISABLE_CREATE_ON_PUSH);
+            }
+        }
+    }
+
     /**
      *
      */
@@ -750,7 +2034,7 @@ class Worker {
 
             if (is_process_local(i)) {
                 auto recv_buffer = their_local_push_buffers.at(i);
-                auto messages_total = valid_buffer_size(*(their_local_push_size.at(i)));
+                auto messages_total = valid_buffer_size(get_messgaes_count_recv(i));
 
                 for (int k = 0; k < messages_total; k++) {
                     auto msg = recv_buffer[k];
@@ -795,8 +2079,7 @@ class Worker {
         std::size_t msg_counter = 0;
 
         for (auto obj_iterator : (*(tables[table_key]->get_items()))) {
-            auto obj = obj_iterator.second;
-            msg.dest_item = obj->myItemKey;
+            msg.dest_item = obj_iterator.first;
             tables[table_key]->apply_push_to_item(msg);
             msg_counter++;
         }
@@ -844,9 +2127,16 @@ class Worker {
      */
      inline std::size_t get_messgaes_count_send(int dest_rank) {
          assert(dest_rank < my_push_buffers_size.size());
-         return *(my_push_buffers_size.at(dest_rank));
+         return buffer_size_count(*(my_push_buffers_size.at(dest_rank)));
      }
 
+    /**
+     * Publish the number of messages in the buffer to dest_rank, tagged with the generation of this exchange
+     */
+    inline void set_messages_count_send(int dest_rank, std::size_t messages_total) {
+        *(my_push_buffers_size.at(dest_rank)) = pack_buffer_size(messages_total, send_generation);
+    }
+
     /**
      *
      * @param src_rank
@@ -854,7 +2144,7 @@ class Worker {
      */
     inline std::size_t get_messgaes_count_recv(int src_rank) {
         assert(src_rank < their_local_push_size.size());
-        return *(their_local_push_size.at(src_rank));
+        return buffer_size_count(*(their_local_push_size.at(src_rank)));
     }
 
     /**
@@ -920,6 +2210,36 @@ class Worker {
         //                     May require fetching global_ptr reference in each cycle!
      }
 
+    /**
+     * Under MODULO_HASH each rank owns every N-th key, so dense slots are (key - key_begin) / N
+     */
+    template<typename TableType>
+    auto set_dense_range(TableType* table, ItemKey_T key_begin, ItemKey_T key_end, int) -> decltype(table->stride, bool()) {
+        return table->set_range(key_begin, key_end, total_workers);
+    }
+
+    template<typename TableType>
+    bool set_dense_range(TableType*, ItemKey_T, ItemKey_T, long) {
+        return true;
+    }
+
+    /**
+     * Integer keys under MODULO_HASH, where distrib_hash() is the key as 32-bit value
+     */
+    void get_partitions(const TableKey_T &, const ItemKey_T* item_keys, std::size_t n, std::size_t* ranks, std::true_type) {
+        const uint64_t multiplier = partition_multiplier;
+        const uint32_t divisor = (uint32_t) total_workers;
+        for (std::size_t i = 0; i < n; i++) {
+            ranks[i] = fastmod_u32((uint32_t) distrib_hash(item_keys[i]), multiplier, divisor);
+        }
+    }
+
+    void get_partitions(const TableKey_T & table_key, const ItemKey_T* item_keys, std::size_t n, std::size_t* ranks, std::false_type) {
+        for (std::size_t i = 0; i < n; i++) {
+            ranks[i] = get_partition(table_key, item_keys[i]);
+        }
+    }
+
     /**
      *
      * @param s
@@ -0,0 +1,140 @@
+// Copyright 2019 Saddlebag Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+#include <upcxx/upcxx.hpp>
+#include "saddlebags.hpp"
+#include "check.hpp"
+
+//Checks of active scheduling: work() runs the items activated by activate_slot() or by messages, once, in slot
+//order, and the bits of an item follow it when removals and freezing move it to another slot
+
+template<class TableKey_T, class ItemKey_T, class Msg_T> class Task;
+using TaskItem = Task<uint8_t, int, float>;
+using Table = saddlebags::TableContainer<uint8_t, int, float, TaskItem>;
+
+static Table* table = nullptr;
+static std::vector<int> ran;
+
+template<class TableKey_T, class ItemKey_T, class Msg_T>
+class Task : public saddlebags::Item<TableKey_T, ItemKey_T, Msg_T> {
+    public:
+    // Activate itself again when running, once
+    bool again = false;
+
+    void do_work() override {
+        ran.push_back(this->myItemKey);
+        if (again) {
+            again = false;
+            table->activate_slot(this->table_slot);
+        }
+    }
+};
+
+/**
+ * Keys of the items that run in the next work(), which clears ran
+ */
+std::vector<int> run_active(Table& t) {
+    ran.clear();
+    t.work();
+    return ran;
+}
+
+int main(int argc, char* argv[]) {
+    saddlebags::init();
+
+    {
+        Table t;
+        table = &t;
+        t.myTableKey = 0;
+        t.worker = nullptr;
+        t.active_scheduling = true;
+
+        // New items are active, in more than one word of bits
+        for (int key = 0; key < 150; key++) {
+            t.add_new_item(key);
+        }
+        CHECK(t.count_active() == 150);
+        CHECK(run_active(t).size() == 150);
+        CHECK(t.count_active() == 0);
+        CHECK(run_active(t).empty());
+
+        // Activations and messages make items run once, in slot order
+        t.activate_slot(130);
+        t.activate_slot(2);
+        t.activate_slot(130);
+        t.push_to_item(t.find_item(70), 1.0f);
+        CHECK(t.count_active() == 3);
+        CHECK((run_active(t) == std::vector<int>{2, 70, 130}));
+
+        // An item activated while work() runs, runs in the next one
+        t.find_item(5)->again = true;
+        t.activate_slot(5);
+        CHECK((run_active(t) == std::vector<int>{5}));
+        CHECK(t.count_active() == 1);
+        CHECK((run_active(t) == std::vector<int>{5}));
+        CHECK(t.count_active() == 0);
+
+        // The last item fills the hole of a removed one, and takes its bit along
+        t.activate_slot(149);
+        t.activate_slot(3);
+        CHECK(t.remove_item(0));
+        CHECK(t.find_item(149)->table_slot == 0);
+        CHECK(t.count_active() == 2);
+        CHECK((run_active(t) == std::vector<int>{149, 3}));
+
+        // The bit of a removed item goes with it, and the moved item keeps its own
+        t.activate_slot(t.find_item(10)->table_slot);
+        CHECK(t.remove_item(10));
+        CHECK(t.count_active() == 0);
+        t.activate_slot(t.find_item(20)->table_slot);
+        t.activate_slot(t.find_item(148)->table_slot);
+        CHECK(t.remove_item(20));
+        CHECK(t.count_active() == 1);
+        CHECK((run_active(t) == std::vector<int>{148}));
+
+        // Items in a table which is no longer scheduled actively all run
+        t.active_scheduling = false;
+        CHECK(t.count_active() == 147);
+        t.destroy_items();
+        CHECK(t.count_active() == 0);
+        table = nullptr;
+    }
+
+    {
+        // Freezing puts the items in key order, and the active bits follow
+        Table t;
+        table = &t;
+        t.myTableKey = 0;
+        t.worker = nullptr;
+        t.active_scheduling = true;
+        for (int key = 99; key >= 0; key--) {
+            t.add_new_item(key);
+        }
+        run_active(t);
+        t.activate_slot(t.find_item(90)->table_slot);
+        t.activate_slot(t.find_item(7)->table_slot);
+        t.activate_slot(t.find_item(64)->table_slot);
+        t.freeze();
+        CHECK(t.find_item(7)->table_slot == 7);
+        CHECK(t.count_active() == 3);
+        CHECK((run_active(t) == std::vector<int>{7, 64, 90}));
+        t.thaw();
+        t.destroy_items();
+        table = nullptr;
+    }
+
+    saddlebags::finalize();
+    return saddlebags_test::result("active-scheduling");
+}
@@ -0,0 +1,126 @@
+// Copyright 2019 Saddlebag Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+#include <deque>
+#include <upcxx/upcxx.hpp>
+#include "saddlebags.hpp"
+#include "check.hpp"
+
+//Checks of run_async(): a breadth-first search with active scheduling or vote to halt reaches the distances of
+//a sequential one, and the run ends once no work and no message is left
+
+const int NODES = 200;
+
+std::vector<int> links_of(int key) {
+    return {(key + 1) % NODES, (key * 7 + 3) % NODES, (key * key) % NODES};
+}
+
+template<class TableKey_T, class ItemKey_T, class Msg_T>
+class Bfs : public saddlebags::Item<TableKey_T, ItemKey_T, Msg_T> {
+    public:
+    Msg_T dist = -1;
+    bool changed = false;
+    int runs = 0;
+
+    void on_create() override {
+        if (this->myItemKey == 0) {
+            dist = 0;
+            changed = true;
+        }
+    }
+
+    void on_push_recv(Msg_T v) override {
+        if (dist < 0 || v < dist) {
+            dist = v;
+            changed = true;
+        }
+    }
+
+    void do_work() override {
+        runs++;
+        if (changed) {
+            this->push_many(this->myTableKey, links_of(this->myItemKey), dist + 1);
+            changed = false;
+        }
+        this->vote_to_halt();
+    }
+};
+
+using BfsItem = Bfs<uint8_t, int, float>;
+
+std::vector<float> sequential_bfs() {
+    std::vector<float> dist(NODES, -1);
+    std::deque<int> queue = {0};
+    dist[0] = 0;
+    while (!queue.empty()) {
+        int key = queue.front();
+        queue.pop_front();
+        for (auto link : links_of(key)) {
+            if (dist[link] < 0) {
+                dist[link] = dist[key] + 1;
+                queue.push_back(link);
+            }
+        }
+    }
+    return dist;
+}
+
+int main(int argc, char* argv[]) {
+    saddlebags::init();
+
+    auto expected = sequential_bfs();
+
+    for (int halting = 0; halting < 2; halting++) {
+        auto worker = saddlebags::create_worker<uint8_t, int, float>(1000);
+        worker->add_table<Bfs>(0);
+        std::vector<BfsItem*> items;
+        for (int key = 0; key < NODES; key++) {
+            items.push_back(worker->add_item<Bfs>(0, key));
+        }
+        if (halting) {
+            worker->enable_vote_to_halt(0);
+        } else {
+            worker->set_active_scheduling(0);
+        }
+
+        // A single rank has no buffer to send
+        CHECK(worker->run_async() == 0);
+        CHECK(worker->is_halted());
+        CHECK(worker->count_active() == 0);
+
+        std::vector<float> dist;
+        bool ran = true;
+        for (auto obj : items) {
+            dist.push_back(obj->dist);
+            ran = ran && obj->runs > 0;
+        }
+        CHECK(dist == expected);
+        CHECK(ran);
+
+        // Nothing is left for the cycles that follow
+        worker->cycle(2);
+        bool settled = true;
+        for (int key = 0; key < NODES; key++) {
+            settled = settled && items[key]->dist == expected[key];
+        }
+        CHECK(settled);
+        CHECK(worker->count_active() == 0);
+
+        worker = saddlebags::destroy_worker(worker);
+    }
+
+    saddlebags::finalize();
+    return saddlebags_test::result("async-run");
+}
@@ -0,0 +1,104 @@
+// Copyright 2019 Saddlebag Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <vector>
+#include <upcxx/upcxx.hpp>
+#include "saddlebags.hpp"
+#include "check.hpp"
+
+//Checks of the size words of push buffers, which carry the generation of the exchange next to the count, and of
+//jobs with cached sizes, whose buffers grow and shrink from cycle to cycle
+
+const int ITEMS = 30;
+
+template<class TableKey_T, class ItemKey_T, class Msg_T>
+class Burst : public saddlebags::Item<TableKey_T, ItemKey_T, Msg_T> {
+    public:
+    int cycles = 0;
+    Msg_T received = 0;
+    int pushes = 0;
+
+    void do_work() override {
+        // 0, 1, 2, 3, 0, ... pushes per item, so that the buffers grow for three cycles and then shrink
+        int n = cycles++ % 4;
+        for (int i = 0; i < n; i++) {
+            this->push(0, (this->myItemKey * 5 + i) % ITEMS, (Msg_T) (this->myItemKey + i));
+        }
+    }
+
+    void on_push_recv(Msg_T v) override {
+        received += v;
+        pushes++;
+    }
+};
+
+using BurstItem = Burst<uint8_t, int, float>;
+
+std::vector<float> run(bool cached, int cycles) {
+    auto worker = saddlebags::create_worker<uint8_t, int, float>(1000);
+    worker->add_table<Burst>(0);
+    std::vector<BurstItem*> items;
+    for (int key = 0; key < ITEMS; key++) {
+        items.push_back(worker->add_item<Burst>(0, key));
+    }
+    if (cached) {
+        worker->enable_cached_sizes();
+    }
+    worker->cycle(cycles);
+
+    std::vector<float> received;
+    for (auto obj : items) {
+        received.push_back(obj->received);
+        received.push_back((float) obj->pushes);
+    }
+    worker = saddlebags::destroy_worker(worker);
+    return received;
+}
+
+int main(int argc, char* argv[]) {
+    saddlebags::init();
+
+    const std::size_t max_count = (std::size_t(1) << BUFFER_SIZE_COUNT_BITS) - 1;
+    const std::size_t max_generation = (std::size_t(1) << (64 - BUFFER_SIZE_COUNT_BITS)) - 1;
+    const std::size_t counts[] = {0, 1, 1000, max_count};
+    const std::size_t generations[] = {0, 1, 7, max_generation};
+    bool round_trip = true;
+    for (auto count : counts) {
+        for (auto generation : generations) {
+            std::size_t word = saddlebags::pack_buffer_size(count, generation);
+            round_trip = round_trip && saddlebags::buffer_size_count(word) == count
+                                    && saddlebags::buffer_size_generation(word) == generation;
+        }
+    }
+    CHECK(round_trip);
+
+    // A count of 0 tells the generations apart, and a full count does not reach into the generation
+    CHECK(saddlebags::pack_buffer_size(0, 1) != saddlebags::pack_buffer_size(0, 2));
+    CHECK(saddlebags::buffer_size_generation(saddlebags::pack_buffer_size(max_count, 0)) == 0);
+
+    // Every push of the last cycle but one is received, in both modes
+    auto plain = run(false, 10);
+    float pushes = 0;
+    for (std::size_t i = 1; i < plain.size(); i += 2) {
+        pushes += plain[i];
+    }
+    // Cycles 0..8 are received, with 0+1+2+3+0+1+2+3+0 pushes per item
+    CHECK(pushes == ITEMS * 12);
+    CHECK(plain == run(true, 10));
+    CHECK(run(false, 7) == run(true, 7));
+
+    saddlebags::finalize();
+    return saddlebags_test::result("cached-sizes");
+}
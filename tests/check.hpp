@@ -0,0 +1,51 @@
+// Copyright 2019 Saddlebag Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CHECK_HPP
+#define CHECK_HPP
+
+#include <iostream>
+
+//Minimal checks for the tests. A failed check prints its condition and line, and the test goes on,
+//so that one run reports every failure.
+
+namespace saddlebags_test
+{
+
+static int failures = 0;
+
+inline void check(bool ok, const char* condition, const char* file, int line) {
+    if (!ok) {
+        std::cout << file << ":" << line << ": check failed: " << condition << std::endl;
+        failures++;
+    }
+}
+
+/**
+ * Report the result of the test, to be returned from main()
+ */
+inline int result(const char* test) {
+    if (failures == 0) {
+        std::cout << test << ": passed" << std::endl;
+        return 0;
+    }
+    std::cout << test << ": " << failures << " checks failed" << std::endl;
+    return 1;
+}
+
+}//end namespace
+
+#define CHECK(condition) saddlebags_test::check((condition), #condition, __FILE__, __LINE__)
+
+#endif
@@ -0,0 +1,183 @@
+// Copyright 2019 Saddlebag Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <upcxx/upcxx.hpp>
+#include "saddlebags.hpp"
+#include "check.hpp"
+
+//Checks of ColumnTableContainer: the values of each item stay in its slot of the columns while items are
+//removed and the table is frozen, and a column kernel replaces the work hooks
+
+static int hooks_run = 0;
+
+template<class TableKey_T, class ItemKey_T, class Msg_T>
+class Point : public saddlebags::ColumnItem<TableKey_T, ItemKey_T, Msg_T, float, int> {
+    public:
+    void on_create() override {
+        this->template column<1>() = (int) this->myItemKey;
+    }
+
+    void on_push_recv(Msg_T val) override {
+        this->template column<0>() += val;
+    }
+
+    void do_work() override {
+        hooks_run++;
+    }
+};
+
+template<class TableKey_T, class ItemKey_T, class Msg_T>
+class Scaled : public saddlebags::ColumnItem<TableKey_T, ItemKey_T, Msg_T, float> {
+    public:
+    void on_create() override {
+        this->template column<0>() = 1;
+    }
+
+    void do_work() override {
+        hooks_run++;
+    }
+
+    static void work_columns(typename Scaled::Columns& columns) {
+        float* values = columns.template column<0>();
+        for (std::size_t i = 0; i < columns.size; i++) {
+            values[i] *= 2;
+        }
+    }
+};
+
+using PointItem = Point<uint8_t, int, float>;
+using ScaledItem = Scaled<uint8_t, int, float>;
+
+/**
+ * Every item finds its own key in column 1, at its slot
+ */
+template<class Table>
+bool keys_in_slots(Table& table) {
+    if (table.columns.size != table.work_items.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < table.work_items.size(); i++) {
+        auto obj = table.work_items[i];
+        if (obj->table_slot != i || table.columns.template column<1>()[i] != obj->myItemKey
+            || obj->template column<1>() != obj->myItemKey) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    saddlebags::init();
+
+    static_assert(saddlebags::has_columns<PointItem>::value, "Point declares columns");
+    static_assert(!saddlebags::has_column_kernel<PointItem>::value, "Point has no column kernel");
+    static_assert(saddlebags::has_column_kernel<ScaledItem>::value, "Scaled has a column kernel");
+
+    {
+        saddlebags::ColumnTableContainer<uint8_t, int, float, PointItem> table;
+        table.myTableKey = 0;
+        table.worker = nullptr;
+
+        for (int key = 0; key < 100; key++) {
+            table.add_new_item(key);
+        }
+        CHECK(table.columns.size == 100);
+        CHECK(keys_in_slots(table));
+
+        // The last slot moves into the hole of a removed item, with its values
+        table.push_to_item(table.find_item(99), 4.5f);
+        CHECK(table.remove_item(0));
+        CHECK(table.remove_item(50));
+        CHECK(table.remove_item(98));
+        CHECK(!table.remove_item(50));
+        CHECK(table.columns.size == 97);
+        CHECK(keys_in_slots(table));
+        CHECK(table.find_item(99)->column<0>() == 4.5f);
+        CHECK(table.find_item(0) == nullptr);
+
+        table.push_to_item(table.find_item(10), 2.5f);
+        table.push_to_item(table.find_item(10), 1.0f);
+        CHECK(table.find_item(10)->column<0>() == 3.5f);
+
+        // Freezing relocates the items in key order, and the columns follow
+        table.freeze();
+        CHECK(keys_in_slots(table));
+        CHECK(table.work_items.front()->myItemKey == 1);
+        CHECK(table.work_items.back()->myItemKey == 99);
+        CHECK(table.find_item(10)->column<0>() == 3.5f);
+        CHECK(table.find_item(99)->column<0>() == 4.5f);
+
+        table.thaw();
+        table.add_new_item(200);
+        CHECK(keys_in_slots(table));
+        CHECK(table.find_item(200)->column<0>() == 0.0f);
+
+        hooks_run = 0;
+        table.work();
+        CHECK(hooks_run == 98);
+
+        table.destroy_items();
+        CHECK(table.columns.size == 0);
+        CHECK(table.columns.list.values.empty());
+        CHECK(table.work_items.empty());
+    }
+
+    {
+        saddlebags::ColumnTableContainer<uint8_t, int, float, ScaledItem> table;
+        table.myTableKey = 0;
+        table.worker = nullptr;
+        for (int key = 0; key < 10; key++) {
+            table.add_new_item(key);
+        }
+        table.remove_item(3);
+
+        // The kernel runs over all slots at once, and the hooks of the items do not run
+        hooks_run = 0;
+        table.work();
+        table.work();
+        CHECK(hooks_run == 0);
+        float sum = 0;
+        for (auto obj : table.work_items) {
+            sum += obj->column<0>();
+        }
+        CHECK(sum == 9 * 4.0f);
+
+        // With vote to halt, items stay active after the kernel ran, until they vote to halt
+        table.active_scheduling = true;
+        table.keep_active = true;
+        table.activate_all();
+        CHECK(table.count_active() == 9);
+        table.work();
+        CHECK(table.count_active() == 9);
+        table.halt_slot(2);
+        table.halt_slot(5);
+        table.work();
+        CHECK(table.count_active() == 7);
+        table.work();
+        CHECK(table.count_active() == 7);
+        // A message wakes a halted item up again
+        table.push_to_item(table.work_items[2], 1.0f);
+        CHECK(table.count_active() == 8);
+        table.work();
+        CHECK(table.count_active() == 8);
+
+        // Without vote to halt, only messages activate items
+        table.keep_active = false;
+        table.work();
+        CHECK(table.count_active() == 0);
+    }
+
+    saddlebags::finalize();
+    return saddlebags_test::result("column-table");
+}
@@ -0,0 +1,121 @@
+// Copyright 2019 Saddlebag Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+#include <upcxx/upcxx.hpp>
+#include "saddlebags.hpp"
+#include "check.hpp"
+
+//Checks of the communication plan: jobs give the same results with and without it, also when the pushes
+//of a cycle deviate from the recorded ones, when items are removed, and when the plan is turned off
+
+const int ITEMS = 40;
+
+// Key whose item pushes to one more Item in the cycle given, or -1
+static int detour_key = -1;
+static int detour_cycle = -1;
+
+template<class TableKey_T, class ItemKey_T, class Msg_T>
+class Node : public saddlebags::Item<TableKey_T, ItemKey_T, Msg_T> {
+    public:
+    Msg_T val = 1;
+    Msg_T sum = 0;
+    int cycles = 0;
+
+    void before_work() override {
+        // Small integers, so that float sums are exact in any order
+        if (cycles > 0) {
+            val = (Msg_T) ((int) sum % 97 + 1);
+        }
+        sum = 0;
+        cycles++;
+    }
+
+    void do_work() override {
+        ItemKey_T key = this->myItemKey;
+        this->push(0, (key * 7 + 1) % ITEMS, val);
+        this->push_many(0, {(key * 3 + 2) % ITEMS, (key + 1) % ITEMS}, {val, 2 * val});
+        if (key == detour_key && cycles == detour_cycle) {
+            this->push(0, (key + 5) % ITEMS, 3 * val);
+        }
+    }
+
+    void on_push_recv(Msg_T v) override {
+        sum += v;
+    }
+};
+
+using NodeItem = Node<uint8_t, int, float>;
+
+/**
+ * Values of all Items after the cycles given, or -1 for removed Items.
+ * The Item of remove_key is removed after the cycle remove_after.
+ */
+std::vector<float> run(bool plan, int cycles, int remove_key = -1, int remove_after = -1, int plan_off_after = -1) {
+    auto worker = saddlebags::create_worker<uint8_t, int, float>(1000);
+    worker->add_table<Node>(0);
+    std::vector<NodeItem*> items;
+    for (int key = 0; key < ITEMS; key++) {
+        items.push_back(worker->add_item<Node>(0, key));
+    }
+    if (plan) {
+        worker->enable_comm_plan();
+    }
+
+    for (int c = 0; c < cycles; c++) {
+        worker->cycle(1);
+        if (c == remove_after) {
+            worker->remove_item(0, remove_key);
+            items[remove_key] = nullptr;
+        }
+        if (c == plan_off_after) {
+            worker->enable_comm_plan(false);
+        }
+    }
+
+    std::vector<float> vals;
+    for (auto obj : items) {
+        vals.push_back(obj != nullptr ? obj->val : -1.0f);
+    }
+    worker = saddlebags::destroy_worker(worker);
+    return vals;
+}
+
+int main(int argc, char* argv[]) {
+    saddlebags::init();
+
+    auto plain = run(false, 10);
+    CHECK(plain == run(true, 10));
+    CHECK(plain == run(true, 10, -1, -1, 5));
+
+    // Values change every cycle, so that a replay of stale values would show
+    CHECK(plain != run(false, 9));
+
+    // An extra push in a replayed cycle
+    detour_key = 11;
+    detour_cycle = 6;
+    auto detoured = run(false, 10);
+    CHECK(detoured != plain);
+    CHECK(detoured == run(true, 10));
+    detour_key = -1;
+
+    // A removal changes the slots of the other Items, and pushes to the removed one are dropped
+    auto removed = run(false, 10, 4, 5);
+    CHECK(removed[4] == -1.0f);
+    CHECK(removed == run(true, 10, 4, 5));
+    CHECK(run(false, 10, 4, 0) == run(true, 10, 4, 0));
+
+    saddlebags::finalize();
+    return saddlebags_test::result("comm-plan");
+}
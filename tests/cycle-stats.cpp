@@ -0,0 +1,201 @@
+// Copyright 2019 Saddlebag Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <upcxx/upcxx.hpp>
+#include "saddlebags.hpp"
+#include "check.hpp"
+
+//Checks of PhaseTimings: the ring of recorded cycles, the laps charged to each phase, the CSV and JSON it
+//writes, and the names of the files of each rank. Checks of the load report built from the cycles of all ranks.
+
+/**
+ * Load values of one cycle of a rank
+ */
+void add_cycle(std::vector<double>& values, unsigned int cycle, double barrier, double work, double receive, std::size_t items) {
+    saddlebags::CycleTiming record;
+    record.cycle = cycle;
+    record.phase_seconds[saddlebags::PhaseBarrier] = barrier;
+    record.phase_seconds[saddlebags::PhaseWork] = work;
+    record.phase_seconds[saddlebags::PhaseRemoteRecv] = receive;
+    record.items = items;
+    saddlebags::append_load_values(values, record);
+}
+
+std::vector<std::string> lines(const std::string& text) {
+    std::vector<std::string> result;
+    std::istringstream in(text);
+    std::string line;
+    while (std::getline(in, line)) {
+        result.push_back(line);
+    }
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    saddlebags::init();
+
+    {
+        // Disabled timings record nothing
+        saddlebags::PhaseTimings timings;
+        timings.begin_cycle(0);
+        timings.lap(saddlebags::PhaseWork);
+        timings.end_cycle(10);
+        CHECK(timings.get_records().empty());
+    }
+
+    {
+        // Only the last 3 of 5 cycles are kept, oldest first
+        saddlebags::PhaseTimings timings;
+        timings.enable(3);
+        for (unsigned int cycle = 0; cycle < 5; cycle++) {
+            timings.begin_cycle(cycle);
+            timings.lap(saddlebags::PhaseBarrier);
+            timings.lap(saddlebags::PhaseWork);
+            timings.lap(saddlebags::PhaseWork);
+            timings.end_cycle(100 + cycle);
+        }
+        auto records = timings.get_records();
+        CHECK(records.size() == 3);
+        bool ordered = true;
+        bool timed = true;
+        for (std::size_t i = 0; i < records.size(); i++) {
+            ordered = ordered && records[i].cycle == 2 + i && records[i].items == 102 + i;
+            double phases = 0;
+            for (int p = 0; p < saddlebags::NumCyclePhases; p++) {
+                timed = timed && records[i].phase_seconds[p] >= 0;
+                phases += records[i].phase_seconds[p];
+            }
+            // Laps cover the cycle up to the last lap, and phases without laps stay at 0
+            timed = timed && records[i].total_seconds >= phases && records[i].phase_seconds[saddlebags::PhaseClear] == 0
+                && records[i].receive_seconds() == 0;
+        }
+        CHECK(ordered);
+        CHECK(timed);
+
+        std::ostringstream csv;
+        timings.write_csv(csv, 4);
+        auto csv_lines = lines(csv.str());
+        CHECK(csv_lines.size() == 4);
+        CHECK(csv_lines[0] == "rank,cycle,barrier,size_rget,buffer_rget,local_recv,remote_recv,work,clear,total,items");
+        CHECK(csv_lines[1].compare(0, 4, "4,2,") == 0);
+        CHECK(csv_lines[3].compare(0, 4, "4,4,") == 0);
+        bool columns = true;
+        for (auto& line : csv_lines) {
+            columns = columns && std::count(line.begin(), line.end(), ',') == 10;
+        }
+        CHECK(columns);
+        CHECK(csv_lines[3].substr(csv_lines[3].rfind(',')) == ",104");
+
+        std::ostringstream json;
+        timings.write_json(json, 4);
+        auto json_lines = lines(json.str());
+        CHECK(json_lines.size() == 5);
+        CHECK(json_lines[0] == "{\"rank\": 4, \"cycles\": [");
+        CHECK(json_lines[1].compare(0, 15, "  {\"cycle\": 2, ") == 0);
+        CHECK(json_lines[1].back() == ',');
+        CHECK(json_lines[3].find("\"items\": 104}") != std::string::npos);
+        CHECK(json_lines[4] == "]}");
+    }
+
+    {
+        // An empty record list is still valid output
+        saddlebags::PhaseTimings timings;
+        timings.enable(2);
+        std::ostringstream json;
+        timings.write_json(json, 0);
+        CHECK(json.str() == "{\"rank\": 0, \"cycles\": [\n]}\n");
+        std::ostringstream csv;
+        timings.write_csv(csv, 0);
+        CHECK(lines(csv.str()).size() == 1);
+    }
+
+    {
+        // Rank 2 works twice as long as the others in cycles 7 and 8, and rank 1 receives for longer in cycle 9,
+        // which rank 0 did not record
+        std::vector<std::vector<double>> values(4);
+        for (int rank = 0; rank < 4; rank++) {
+            for (unsigned int cycle = 7; cycle < 10; cycle++) {
+                double work = (rank == 2 && cycle < 9) ? 2.0 : 1.0;
+                double receive = (rank == 1 && cycle == 9) ? 3.0 : 0.5;
+                if (rank > 0 || cycle < 9) {
+                    add_cycle(values[rank], cycle, 0.25 * rank, work, receive, 100 * (rank + 1));
+                }
+            }
+        }
+        auto report = saddlebags::build_load_report(values, 1.25, 0.5);
+        CHECK(report.cycles.size() == 2);
+        CHECK(report.cycles[0].cycle == 7);
+        CHECK(report.cycles[1].cycle == 8);
+        // Work max 2 over mean 5 / 4, items max 400 over mean 250
+        CHECK(report.cycles[0].work_imbalance == 1.6);
+        CHECK(report.cycles[0].receive_imbalance == 1);
+        CHECK(report.cycles[0].items_imbalance == 1.6);
+        CHECK(report.cycles[0].slowest_rank == 2);
+        CHECK((report.cycles[1].barrier_seconds == std::vector<double>{0, 0.25, 0.5, 0.75}));
+        // Busy 2.5 over a mean of 1.875 is slow at 1.25, and not at 1.5
+        CHECK((report.slow_cycles == std::vector<unsigned int>{0, 0, 2, 0}));
+        CHECK((report.stragglers == std::vector<int>{2}));
+        CHECK(report.hosts.empty());
+        CHECK(saddlebags::build_load_report(values, 1.5, 0.5).stragglers.empty());
+        // Slow in one of two cycles makes a straggler at a fraction of a half, and not at three quarters
+        values[2][saddlebags::LOAD_VALUES_PER_CYCLE + 2] = 1.0;
+        CHECK(saddlebags::build_load_report(values, 1.25, 0.5).stragglers.size() == 1);
+        CHECK(saddlebags::build_load_report(values, 1.25, 0.75).stragglers.empty());
+
+        // With equal busy times the first rank counts as the slowest, and idle cycles are balanced
+        std::vector<std::vector<double>> idle(3);
+        for (int rank = 0; rank < 3; rank++) {
+            add_cycle(idle[rank], 0, 0, 0, 0, 0);
+        }
+        report = saddlebags::build_load_report(idle, 1.25, 0.5);
+        CHECK(report.cycles.size() == 1);
+        CHECK(report.cycles[0].slowest_rank == 0);
+        CHECK(report.cycles[0].work_imbalance == 1);
+        CHECK(report.cycles[0].items_imbalance == 1);
+        CHECK(report.stragglers.empty());
+        CHECK(saddlebags::build_load_report(std::vector<std::vector<double>>(2), 1.25, 0.5).cycles.empty());
+    }
+
+    {
+        // On a single rank, every recorded cycle is balanced
+        auto worker = saddlebags::create_worker<uint8_t, int, float>(100);
+        worker->enable_phase_timings();
+        worker->cycle(3);
+        auto report = worker->load_report();
+        CHECK(report.cycles.size() == 3);
+        CHECK(report.hosts.size() == 1);
+        CHECK(report.stragglers.empty());
+        bool balanced = true;
+        for (auto& load : report.cycles) {
+            balanced = balanced && load.work_imbalance == 1 && load.slowest_rank == 0;
+        }
+        CHECK(balanced);
+        worker = saddlebags::destroy_worker(worker);
+    }
+
+    CHECK(saddlebags::rank_file_path("timings.csv", 3) == "timings.3.csv");
+    CHECK(saddlebags::rank_file_path("out/run.1/timings.json", 0) == "out/run.1/timings.0.json");
+    CHECK(saddlebags::rank_file_path("out.d/timings", 2) == "out.d/timings.2");
+    CHECK(saddlebags::rank_file_path("timings", 1) == "timings.1");
+    CHECK(saddlebags::is_json_path("trace.json"));
+    CHECK(!saddlebags::is_json_path("trace.csv"));
+    CHECK(!saddlebags::is_json_path("json"));
+
+    saddlebags::finalize();
+    return saddlebags_test::result("cycle-stats");
+}
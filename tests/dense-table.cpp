@@ -0,0 +1,192 @@
+// Copyright 2019 Saddlebag Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <upcxx/upcxx.hpp>
+#include "saddlebags.hpp"
+#include "check.hpp"
+
+//Checks of DenseTableContainer: keys map to slots of their range and stride, items can be removed and added
+//again, and get_items() and the memory report see the array of items
+
+template<class TableKey_T, class ItemKey_T, class Msg_T>
+class Counter : public saddlebags::Item<TableKey_T, ItemKey_T, Msg_T> {
+    public:
+    float received = 0;
+    int works = 0;
+
+    void on_push_recv(Msg_T val) override {
+        received += val;
+    }
+
+    void do_work() override {
+        works++;
+    }
+};
+
+using CounterItem = Counter<uint8_t, int, float>;
+using Table = saddlebags::DenseTableContainer<uint8_t, int, float, CounterItem>;
+
+/**
+ * The item list is packed, and each item knows its slot in it
+ */
+bool items_packed(Table& table) {
+    for (std::size_t i = 0; i < table.work_items.size(); i++) {
+        if (table.work_items[i]->table_slot != i) {
+            return false;
+        }
+    }
+    return table.work_items.size() == table.num_items;
+}
+
+int main(int argc, char* argv[]) {
+    saddlebags::init();
+
+    {
+        // A range with negative keys
+        Table table;
+        table.myTableKey = 0;
+        table.set_range(-50, 50, 1);
+        CHECK(table.dense_items.size() == 100);
+        for (int key = -50; key < 50; key++) {
+            table.add_new_item(key);
+        }
+        CHECK(table.num_items == 100);
+        CHECK(table.find_item(-50) != nullptr && table.find_item(-50)->myItemKey == -50);
+        CHECK(table.find_item(49) != nullptr && table.find_item(49)->myItemKey == 49);
+        CHECK(table.find_item(50) == nullptr);
+        CHECK(table.find_item(-51) == nullptr);
+        CHECK(!table.in_range(50) && !table.in_range(-51));
+        // Keys outside the range are an error, not an abort
+        CHECK(table.add_new_item(50) == nullptr);
+        CHECK(table.add_new_item(-51) == nullptr);
+        CHECK(items_packed(table));
+
+        CHECK(table.remove_item(0));
+        CHECK(table.remove_item(-50));
+        CHECK(!table.remove_item(0));
+        CHECK(table.find_item(0) == nullptr);
+        CHECK(table.num_items == 98);
+        CHECK(items_packed(table));
+        for (int key = -49; key < 50; key++) {
+            CHECK(key == 0 || (table.find_item(key) != nullptr && table.find_item(key)->myItemKey == key));
+        }
+
+        table.add_new_item(0);
+        CHECK(table.find_item(0) != nullptr && table.find_item(0)->myItemKey == 0);
+        CHECK(items_packed(table));
+
+        table.push_to_item(table.find_item(7), 1.5f);
+        table.push_to_item(table.find_item(7), 2.0f);
+        CHECK(table.find_item(7)->received == 3.5f);
+
+        table.work();
+        int works = 0;
+        for (auto obj : table.work_items) {
+            works += obj->works;
+        }
+        CHECK(works == 99);
+
+        // The items are copied into a map for get_items()
+        CHECK(!table.items_in_map());
+        std::size_t viewed = 0;
+        for (auto entry : *table.get_items()) {
+            CHECK(entry.second->myItemKey == entry.first);
+            viewed++;
+        }
+        CHECK(viewed == 99);
+
+        saddlebags::TableMemory memory;
+        table.account_memory(memory);
+        CHECK(memory.items == 99);
+        CHECK(memory.map_slots == 100);
+        CHECK(memory.map_occupied == 99);
+
+        table.destroy_items();
+        CHECK(table.num_items == 0);
+        CHECK(table.dense_items.empty());
+        CHECK(table.work_items.empty());
+    }
+
+    {
+        // A rank that owns every 4th key of the range, as under MODULO_HASH with 4 ranks
+        Table table;
+        table.myTableKey = 0;
+        table.set_range(1, 101, 4);
+        CHECK(table.dense_items.size() == 25);
+        for (int key = 1; key < 101; key += 4) {
+            table.add_new_item(key);
+        }
+        CHECK(table.num_items == 25);
+        for (int key = 1; key < 101; key += 4) {
+            CHECK(table.get_slot(key) == (std::size_t) (key - 1) / 4);
+            CHECK(table.find_item(key) != nullptr && table.find_item(key)->myItemKey == key);
+        }
+        CHECK(table.dense_items.size() == 25);
+    }
+
+    {
+        // With 3 ranks, the keys each rank owns by partitioning each get their own slot
+        for (std::size_t rank = 0; rank < 3; rank++) {
+            Table table;
+            table.myTableKey = 0;
+            CHECK(table.set_range(2, 98, 3));
+            std::size_t added = 0;
+            for (int key = 2; key < 98; key++) {
+                if (saddlebags::distrib_hash((unsigned int) key) % 3 == rank) {
+                    added += table.add_new_item(key) != nullptr;
+                }
+            }
+            CHECK(added == 32);
+            CHECK(table.num_items == 32);
+            std::size_t found = 0;
+            for (int key = 2; key < 98; key++) {
+                auto obj = table.find_item(key);
+                found += obj != nullptr && obj->myItemKey == key;
+            }
+            CHECK(found == 32);
+        }
+    }
+
+    {
+        // Negative keys wrap around in the partitioning: with 3 ranks, -1 and 0 are both on rank 0, and would
+        // share a slot. A strided range from a negative key is rejected, and the table stays unbounded from 0.
+        CHECK(saddlebags::distrib_hash((unsigned int) -1) % 3 == saddlebags::distrib_hash(0u) % 3);
+        Table table;
+        table.myTableKey = 0;
+        CHECK(!table.set_range(-50, 50, 3));
+        CHECK(!table.bounded);
+        CHECK(table.dense_items.empty());
+        CHECK(table.add_new_item(-1) == nullptr);
+        CHECK(table.add_new_item(0) != nullptr);
+        CHECK(table.num_items == 1);
+    }
+
+    {
+        // Without a range, keys start at 0 and the array grows with the largest key
+        Table table;
+        table.myTableKey = 0;
+        table.set_range(0, 0, 1);
+        CHECK(!table.bounded);
+        table.add_new_item(3);
+        table.add_new_item(1000);
+        CHECK(table.dense_items.size() == 1001);
+        CHECK(table.find_item(1000) != nullptr && table.find_item(1000)->myItemKey == 1000);
+        CHECK(table.find_item(4000) == nullptr);
+        CHECK(table.find_item(4) == nullptr);
+        CHECK(table.num_items == 2);
+    }
+
+    saddlebags::finalize();
+    return saddlebags_test::result("dense-table");
+}
@@ -0,0 +1,156 @@
+// Copyright 2019 Saddlebag Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <random>
+#include <upcxx/upcxx.hpp>
+#include "saddlebags.hpp"
+#include "check.hpp"
+
+//Checks of Frozen_Map, the Eytzinger-ordered search of frozen tables, and of lookups in a table through
+//freeze_table() and thaw_table()
+
+using Map = saddlebags::Frozen_Map<int, int>;
+
+/**
+ * Every node of the implicit tree is above its left child and below its right child
+ */
+bool tree_ordered(const Map& map) {
+    for (std::size_t k = 1; k <= map.num_items; k++) {
+        if (2 * k <= map.num_items && !(map.keys[2 * k] < map.keys[k])) {
+            return false;
+        }
+        if (2 * k + 1 <= map.num_items && !(map.keys[k] < map.keys[2 * k + 1])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template<class TableKey_T, class ItemKey_T, class Msg_T>
+class Tagged : public saddlebags::Item<TableKey_T, ItemKey_T, Msg_T> {
+    public:
+    int tag = 0;
+};
+
+using TaggedItem = Tagged<uint8_t, int, float>;
+
+int main(int argc, char* argv[]) {
+    saddlebags::init();
+    std::mt19937 random(7);
+
+    // All sizes up to a few levels, so that the last level is empty, partly and completely filled.
+    // Keys are even, so that the odd keys between them are missing.
+    for (int n = 0; n <= 300; n++) {
+        std::vector<std::pair<int, int>> pairs;
+        for (int i = 0; i < n; i++) {
+            pairs.emplace_back(2 * i - n, i);
+        }
+        std::shuffle(pairs.begin(), pairs.end(), random);
+
+        Map map;
+        map.build(pairs);
+        CHECK(map.num_items == (std::size_t) n);
+        CHECK(tree_ordered(map));
+
+        bool found_all = true;
+        bool missed_all = true;
+        for (int i = 0; i < n; i++) {
+            std::size_t location = map.find_location(2 * i - n);
+            found_all = found_all && location != 0 && map.keys[location] == 2 * i - n && map.values[location] == i;
+            missed_all = missed_all && map.find_location(2 * i - n + 1) == 0;
+        }
+        CHECK(found_all);
+        CHECK(missed_all);
+        CHECK(map.find_location(-n - 1) == 0);
+        CHECK(map.find_location(-n - 2) == 0);
+        CHECK(map.find_location(n + 1) == 0);
+    }
+
+    {
+        Map map;
+        std::vector<std::pair<int, int>> pairs = {{5, 50}, {1, 10}};
+        map.build(pairs);
+        CHECK(map.values[map.find_location(5)] == 50);
+        map.clear();
+        CHECK(map.num_items == 0);
+        CHECK(map.find_location(5) == 0);
+        CHECK(map.bytes() == 0);
+    }
+
+    {
+        saddlebags::TableContainer<uint8_t, int, float, TaggedItem> table;
+        table.myTableKey = 0;
+        std::vector<int> keys;
+        for (int i = 0; i < 1000; i++) {
+            keys.push_back((i * 7919) % 5003 - 2500);
+        }
+        for (auto key : keys) {
+            table.add_new_item(key)->tag = key * 3;
+        }
+        for (std::size_t i = 0; i < keys.size(); i += 10) {
+            table.remove_item(keys[i]);
+        }
+
+        // Items are relocated in key order, keep their state, and are found through the frozen map
+        table.freeze();
+        CHECK(table.frozen);
+        CHECK(table.work_items.size() == 900);
+        bool sorted = true;
+        for (std::size_t i = 0; i + 1 < table.work_items.size(); i++) {
+            sorted = sorted && table.work_items[i]->myItemKey < table.work_items[i + 1]->myItemKey
+                && table.work_items[i]->table_slot == i;
+        }
+        CHECK(sorted);
+
+        bool lookups = true;
+        for (std::size_t i = 0; i < keys.size(); i++) {
+            TaggedItem* obj = table.find_item(keys[i]);
+            if (i % 10 == 0) {
+                lookups = lookups && obj == nullptr;
+            } else {
+                lookups = lookups && obj != nullptr && obj->myItemKey == keys[i] && obj->tag == keys[i] * 3;
+            }
+        }
+        CHECK(lookups);
+        CHECK(table.find_item(5000) == nullptr);
+
+        // The item set can not change while frozen
+        CHECK(table.add_new_item(6000) == nullptr);
+        CHECK(!table.remove_item(keys[1]));
+        CHECK(table.find_item(keys[1]) != nullptr);
+
+        table.thaw();
+        CHECK(!table.frozen);
+        lookups = true;
+        for (std::size_t i = 0; i < keys.size(); i++) {
+            TaggedItem* obj = table.find_item(keys[i]);
+            lookups = lookups && (i % 10 == 0 ? obj == nullptr : obj != nullptr && obj->tag == keys[i] * 3);
+        }
+        CHECK(lookups);
+        CHECK(table.add_new_item(6000) != nullptr);
+        CHECK(table.remove_item(keys[1]));
+        CHECK(table.find_item(keys[1]) == nullptr);
+        CHECK(table.find_item(6000) != nullptr);
+
+        // Freezing twice in a row, with a thaw in between, finds the same items
+        table.freeze();
+        CHECK(table.find_item(6000) != nullptr && table.find_item(6000)->myItemKey == 6000);
+        CHECK(table.find_item(keys[1]) == nullptr);
+        table.thaw();
+    }
+
+    saddlebags::finalize();
+    return saddlebags_test::result("frozen-map");
+}
@@ -0,0 +1,133 @@
+// Copyright 2019 Saddlebag Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+#include <upcxx/upcxx.hpp>
+#include "saddlebags.hpp"
+#include "check.hpp"
+
+//Checks of the memory report: the totals of MemoryReport and TableMemory, what a table accounts for its items,
+//and the report of a Worker with its buffers
+
+template<class TableKey_T, class ItemKey_T, class Msg_T>
+class Plain : public saddlebags::Item<TableKey_T, ItemKey_T, Msg_T> {
+};
+
+template<class TableKey_T, class ItemKey_T, class Msg_T>
+class Holder : public saddlebags::Item<TableKey_T, ItemKey_T, Msg_T> {
+    public:
+    std::vector<int> links;
+
+    std::size_t memory_bytes() override {
+        return links.capacity() * sizeof(int);
+    }
+};
+
+using PlainItem = Plain<uint8_t, int, float>;
+using HolderItem = Holder<uint8_t, int, float>;
+
+int main(int argc, char* argv[]) {
+    saddlebags::init();
+
+    CHECK(saddlebags::format_bytes(0) == "0.0 MiB");
+    CHECK(saddlebags::format_bytes(3 * 1024 * 1024 + 512 * 1024) == "3.5 MiB");
+
+    {
+        saddlebags::TableMemory table;
+        table.map_bytes = 1;
+        table.item_bytes = 2;
+        table.column_bytes = 4;
+        table.list_bytes = 8;
+        table.user_bytes = 16;
+        // Counts of items and slots are not bytes
+        table.items = 1000;
+        table.map_slots = 1000;
+        CHECK(table.total_bytes() == 31);
+
+        saddlebags::MemoryReport report;
+        report.send_buffer_bytes = 100;
+        report.recv_buffer_bytes = 200;
+        report.worker_bytes = 400;
+        report.tables = {table, table};
+        CHECK(report.segment_bytes() == 300);
+        CHECK(report.total_bytes() == 762);
+    }
+
+    CHECK(!saddlebags::has_memory_bytes<PlainItem>::value);
+    CHECK(saddlebags::has_memory_bytes<HolderItem>::value);
+
+    {
+        saddlebags::TableContainer<uint8_t, int, float, PlainItem> table;
+        table.myTableKey = 0;
+        saddlebags::TableMemory empty;
+        table.account_memory(empty);
+        CHECK(empty.items == 0);
+        CHECK(empty.user_bytes == 0);
+
+        for (int key = 0; key < 500; key++) {
+            table.add_new_item(key);
+        }
+        saddlebags::TableMemory memory;
+        table.account_memory(memory);
+        CHECK(memory.items == 500);
+        CHECK(memory.map_occupied == 500);
+        CHECK(memory.map_slots >= 500);
+        CHECK(memory.map_bytes > 0);
+        CHECK(memory.item_bytes >= 500 * sizeof(PlainItem));
+        CHECK(memory.list_bytes >= 500 * sizeof(PlainItem*));
+        CHECK(memory.column_bytes == 0);
+        CHECK(memory.user_bytes == 0);
+        table.destroy_items();
+    }
+
+    {
+        // Bytes reported by the items are summed over all of them
+        saddlebags::TableContainer<uint8_t, int, float, HolderItem> table;
+        table.myTableKey = 0;
+        std::size_t expected = 0;
+        for (int key = 0; key < 100; key++) {
+            auto obj = table.add_new_item(key);
+            obj->links.reserve(key);
+            expected += obj->links.capacity() * sizeof(int);
+        }
+        saddlebags::TableMemory memory;
+        table.account_memory(memory);
+        CHECK(memory.user_bytes == expected);
+        table.destroy_items();
+    }
+
+    {
+        // Every rank has a send buffer, and a receive buffer for each rank outside its node
+        const std::size_t buffer_size = 1000;
+        auto worker = saddlebags::create_worker<uint8_t, int, float>(buffer_size);
+        worker->add_table<Holder>(0);
+        worker->add_table<Plain>(1);
+        for (int key = 0; key < 10; key++) {
+            worker->add_item<Holder>(0, key)->links.resize(4);
+        }
+        auto report = worker->memory_report();
+        CHECK(report.tables.size() == 2);
+        CHECK(report.tables[0].items == 10);
+        CHECK(report.tables[0].user_bytes == 10 * 4 * sizeof(int));
+        CHECK(report.tables[1].items == 0);
+        CHECK(report.send_buffer_bytes >= saddlebags::rank_n() * buffer_size * sizeof(saddlebags::Message<uint8_t, int, float>));
+        CHECK(report.recv_buffer_bytes <= report.send_buffer_bytes);
+        CHECK(report.total_bytes() >= report.segment_bytes() + report.tables[0].total_bytes() + report.tables[1].total_bytes());
+        worker = saddlebags::destroy_worker(worker);
+        CHECK(worker == nullptr);
+    }
+
+    saddlebags::finalize();
+    return saddlebags_test::result("memory-report");
+}
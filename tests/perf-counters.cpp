@@ -0,0 +1,112 @@
+// Copyright 2019 Saddlebag Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+#include <upcxx/upcxx.hpp>
+#include "saddlebags.hpp"
+#include "check.hpp"
+
+//Checks of the sums of performance counter differences: counts of an interval in which the group did not run
+//all the time are scaled up by that interval, and failed reads are skipped. Counters that can not be opened
+//leave the phases at zero.
+
+saddlebags::PerfCounts counts(uint64_t base, uint64_t enabled, uint64_t running) {
+    saddlebags::PerfCounts read;
+    for (int c = 0; c < saddlebags::NumPerfCounters; c++) {
+        read.values[c] = base * (c + 1);
+    }
+    read.time_enabled = enabled;
+    read.time_running = running;
+    return read;
+}
+
+bool all_values(const saddlebags::PerfCounts& sum, uint64_t base) {
+    bool equal = true;
+    for (int c = 0; c < saddlebags::NumPerfCounters; c++) {
+        equal = equal && sum.values[c] == base * (c + 1);
+    }
+    return equal;
+}
+
+int main(int argc, char* argv[]) {
+    saddlebags::init();
+
+    {
+        saddlebags::PerfCounts sum;
+
+        // Always on the PMU: counted as read
+        sum.add_difference(counts(1100, 2000, 2000), counts(100, 1000, 1000));
+        CHECK(all_values(sum, 1000));
+        CHECK(sum.time_enabled == 1000);
+        CHECK(sum.time_running == 1000);
+
+        // On the PMU for a quarter of the interval: four times the count, whatever the totals since the start
+        sum.add_difference(counts(1600, 6000, 3000), counts(1100, 2000, 2000));
+        CHECK(all_values(sum, 1000 + 4 * 500));
+        CHECK(sum.time_enabled == 5000);
+        CHECK(sum.time_running == 2000);
+
+        // Not on the PMU at all: nothing counted, and nothing to scale
+        sum.add_difference(counts(1600, 7000, 3000), counts(1600, 6000, 3000));
+        CHECK(all_values(sum, 3000));
+        CHECK(sum.time_enabled == 6000);
+
+        // A failed read is all zeros, and the interval it ends or starts is skipped
+        sum.add_difference(saddlebags::PerfCounts(), counts(1600, 7000, 3000));
+        sum.add_difference(counts(1700, 7100, 3100), saddlebags::PerfCounts());
+        CHECK(all_values(sum, 3000));
+        CHECK(sum.time_enabled == 6000);
+    }
+
+    {
+        saddlebags::PhaseCounters disabled;
+        CHECK(disabled.add_region("load") == 0);
+        CHECK(disabled.add_region("rank") == 1);
+        disabled.begin_laps();
+        disabled.lap(saddlebags::PhaseWork);
+        disabled.begin_region(1);
+        disabled.end_region(1);
+        auto values = disabled.flatten();
+        CHECK(values.size() == (saddlebags::NumCyclePhases + 2) * saddlebags::NumPerfCounters);
+        bool zeros = true;
+        for (auto value : values) {
+            zeros = zeros && value == 0;
+        }
+        CHECK(zeros);
+
+        saddlebags::PerfCounts read;
+        disabled.group.read(read);
+        CHECK(read.time_enabled == 0);
+    }
+
+    {
+        // Machines without counters, or which do not allow them, leave the group closed
+        saddlebags::PhaseCounters counters;
+        if (counters.enable()) {
+            CHECK(!counters.group.opened.empty());
+            counters.begin_laps();
+            volatile uint64_t spin = 0;
+            for (int i = 0; i < 100000; i++) {
+                spin += i;
+            }
+            counters.lap(saddlebags::PhaseWork);
+            CHECK(counters.phase_counts[saddlebags::PhaseWork].time_enabled > 0);
+        } else {
+            CHECK(counters.group.opened.empty());
+        }
+    }
+
+    saddlebags::finalize();
+    return saddlebags_test::result("perf-counters");
+}
@@ -0,0 +1,223 @@
+// Copyright 2019 Saddlebag Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <vector>
+#include <upcxx/upcxx.hpp>
+#include "saddlebags.hpp"
+#include "check.hpp"
+
+//Checks of priority scheduling: items run once per work(), lowest bucket first, an item whose priority rose runs
+//in its new bucket, and shortest paths found bucket by bucket are those of Dijkstra's algorithm
+
+template<class TableKey_T, class ItemKey_T, class Msg_T> class Job;
+using JobItem = Job<uint8_t, int, float>;
+using Table = saddlebags::TableContainer<uint8_t, int, float, JobItem>;
+
+static std::vector<int> ran;
+
+template<class TableKey_T, class ItemKey_T, class Msg_T>
+class Job : public saddlebags::Item<TableKey_T, ItemKey_T, Msg_T> {
+    public:
+    double prio = 0;
+    // Item whose priority is raised when this one runs, if any
+    JobItem* raise = nullptr;
+
+    double priority() override {
+        return prio;
+    }
+
+    void do_work() override {
+        ran.push_back(this->myItemKey);
+        if (raise != nullptr) {
+            raise->prio += 100;
+        }
+    }
+};
+
+const int NODES = 300;
+
+std::vector<std::pair<int, float>> edges_of(int key) {
+    return {{(key + 1) % NODES, (float) (key % 7 + 1)}, {(key * 13 + 5) % NODES, (float) (key % 3 + 4)},
+            {(key * key + 1) % NODES, 9.0f}};
+}
+
+template<class TableKey_T, class ItemKey_T, class Msg_T>
+class Path : public saddlebags::Item<TableKey_T, ItemKey_T, Msg_T> {
+    public:
+    Msg_T dist = std::numeric_limits<Msg_T>::infinity();
+    bool changed = false;
+
+    void on_create() override {
+        if (this->myItemKey == 0) {
+            dist = 0;
+            changed = true;
+        }
+    }
+
+    void on_push_recv(Msg_T v) override {
+        if (v < dist) {
+            dist = v;
+            changed = true;
+        }
+    }
+
+    // Unreached items have an infinite priority, which falls into the last bucket
+    double priority() override {
+        return dist;
+    }
+
+    void do_work() override {
+        if (changed) {
+            for (auto edge : edges_of(this->myItemKey)) {
+                this->push(this->myTableKey, edge.first, dist + edge.second);
+            }
+            changed = false;
+        }
+    }
+};
+
+using PathItem = Path<uint8_t, int, float>;
+
+std::vector<float> dijkstra() {
+    std::vector<float> dist(NODES, std::numeric_limits<float>::infinity());
+    std::priority_queue<std::pair<float, int>, std::vector<std::pair<float, int>>, std::greater<std::pair<float, int>>> queue;
+    dist[0] = 0;
+    queue.push({0.0f, 0});
+    while (!queue.empty()) {
+        auto top = queue.top();
+        queue.pop();
+        if (top.first > dist[top.second]) {
+            continue;
+        }
+        for (auto edge : edges_of(top.second)) {
+            if (top.first + edge.second < dist[edge.first]) {
+                dist[edge.first] = top.first + edge.second;
+                queue.push({dist[edge.first], edge.first});
+            }
+        }
+    }
+    return dist;
+}
+
+/**
+ * Run all buckets of the table, as Worker::work_by_priority() does without messages
+ */
+void run_buckets(Table& t) {
+    t.start_buckets();
+    long bucket;
+    while (t.lowest_bucket(bucket)) {
+        t.run_bucket(bucket);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    saddlebags::init();
+
+    {
+        Table t;
+        t.myTableKey = 0;
+        t.worker = nullptr;
+        t.active_scheduling = true;
+        t.priority_delta = 10;
+        for (int key = 0; key < 6; key++) {
+            t.add_new_item(key);
+        }
+
+        // Buckets round down, and the infinities and NaN fall into the outermost buckets
+        const double inf = std::numeric_limits<double>::infinity();
+        const double prios[] = {25, -5, 9.99, std::nan(""), inf, -inf};
+        const long buckets[] = {2, -1, 0, std::numeric_limits<long>::max(), std::numeric_limits<long>::max(),
+                                std::numeric_limits<long>::min()};
+        bool bucketed = true;
+        for (int key = 0; key < 6; key++) {
+            t.find_item(key)->prio = prios[key];
+            bucketed = bucketed && t.get_bucket(t.find_item(key)) == buckets[key];
+        }
+        CHECK(bucketed);
+        t.find_item(0)->prio = 1e300;
+        CHECK(t.get_bucket(t.find_item(0)) == std::numeric_limits<long>::max());
+        t.find_item(0)->prio = 25;
+
+        // Lowest bucket first, in slot order within a bucket
+        ran.clear();
+        run_buckets(t);
+        CHECK((ran == std::vector<int>{5, 1, 2, 0, 3, 4}));
+        CHECK(t.count_active() == 0);
+        CHECK(t.priority_buckets.empty());
+
+        // An item whose priority rose before its bucket came up runs in its new bucket, once
+        t.find_item(1)->raise = t.find_item(2);
+        t.find_item(2)->prio = 5;
+        t.activate_all();
+        ran.clear();
+        run_buckets(t);
+        CHECK((ran == std::vector<int>{5, 1, 0, 2, 3, 4}));
+
+        // Items which join the running ones between buckets run in the same work()
+        t.find_item(1)->raise = nullptr;
+        t.find_item(2)->prio = 5;
+        t.activate_slot(t.find_item(1)->table_slot);
+        t.start_buckets();
+        long bucket;
+        CHECK(t.lowest_bucket(bucket));
+        CHECK(bucket == -1);
+        ran.clear();
+        t.run_bucket(bucket);
+        t.join_running(true);
+        t.activate_slot(t.find_item(2)->table_slot);
+        t.activate_slot(t.find_item(0)->table_slot);
+        t.join_running(false);
+        while (t.lowest_bucket(bucket)) {
+            t.run_bucket(bucket);
+        }
+        CHECK((ran == std::vector<int>{1, 2, 0}));
+        CHECK(t.count_active() == 0);
+
+        // A removal moves the last item into the hole, and it still runs in its bucket
+        t.activate_all();
+        t.start_buckets();
+        CHECK(t.remove_item(1));
+        ran.clear();
+        while (t.lowest_bucket(bucket)) {
+            t.run_bucket(bucket);
+        }
+        CHECK((ran == std::vector<int>{5, 2, 0, 3, 4}));
+        t.destroy_items();
+    }
+
+    {
+        auto expected = dijkstra();
+        auto worker = saddlebags::create_worker<uint8_t, int, float>(1000);
+        worker->add_table<Path>(0);
+        std::vector<PathItem*> items;
+        for (int key = 0; key < NODES; key++) {
+            items.push_back(worker->add_item<Path>(0, key));
+        }
+        worker->set_priority_scheduling(0, 3.0);
+        worker->cycle(NODES);
+        bool shortest = true;
+        for (int key = 0; key < NODES; key++) {
+            shortest = shortest && items[key]->dist == expected[key];
+        }
+        CHECK(shortest);
+        CHECK(worker->count_active() == 0);
+        worker = saddlebags::destroy_worker(worker);
+    }
+
+    saddlebags::finalize();
+    return saddlebags_test::result("priority-buckets");
+}
@@ -0,0 +1,147 @@
+// Copyright 2019 Saddlebag Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+#include <upcxx/upcxx.hpp>
+#include "saddlebags.hpp"
+#include "check.hpp"
+
+//Checks of batched pushes: staged values are grouped per item in the order they were received, and a removal
+//first hands the item the values staged before it, while the other items keep theirs until the end of the cycle
+
+// Batches seen by the items of the worker test, as they are deleted on removal
+static std::vector<std::vector<float>> removed_batches;
+
+template<class TableKey_T, class ItemKey_T, class Msg_T>
+class Batched : public saddlebags::Item<TableKey_T, ItemKey_T, Msg_T> {
+    public:
+    std::vector<std::vector<Msg_T>> batches;
+
+    void on_push_batch(const Msg_T* vals, std::size_t n) override {
+        batches.emplace_back(vals, vals + n);
+    }
+
+    void on_remove() override {
+        for (auto& batch : batches) {
+            removed_batches.push_back(batch);
+        }
+    }
+};
+
+template<class TableKey_T, class ItemKey_T, class Msg_T>
+class Sender : public saddlebags::Item<TableKey_T, ItemKey_T, Msg_T> {
+    public:
+    bool sent = false;
+
+    void do_work() override {
+        if (sent) {
+            return;
+        }
+        sent = true;
+        this->push(1, 5, 1.0f);
+        this->push(1, 6, 10.0f);
+        this->push(1, 5, 2.0f);
+        this->remove(1, 5);
+        this->push(1, 5, 3.0f);
+        this->push(1, 6, 20.0f);
+    }
+};
+
+using BatchedItem = Batched<uint8_t, int, float>;
+using Table = saddlebags::TableContainer<uint8_t, int, float, BatchedItem>;
+
+saddlebags::Message<uint8_t, int, float> push_msg(int key, float val) {
+    saddlebags::Message<uint8_t, int, float> msg;
+    msg.dest_item = key;
+    msg.value = val;
+    return msg;
+}
+
+int main(int argc, char* argv[]) {
+    saddlebags::init();
+
+    {
+        Table table;
+        table.myTableKey = 0;
+        table.worker = nullptr;
+        table.batch_pushes = true;
+        table.add_new_item(3);
+        table.add_new_item(1);
+
+        // Keys are grouped, and each group keeps the order of arrival
+        table.stage_push(push_msg(3, 1.0f));
+        table.stage_push(push_msg(1, 2.0f));
+        table.stage_push(push_msg(3, 3.0f));
+        table.stage_push(push_msg(1, 4.0f));
+        table.stage_push(push_msg(3, 5.0f));
+        table.stage_push(push_msg(7, 6.0f));
+        table.deliver_staged_pushes(false);
+        CHECK(table.staged_pushes.empty());
+        CHECK((table.find_item(3)->batches == std::vector<std::vector<float>>{{1.0f, 3.0f, 5.0f}}));
+        CHECK((table.find_item(1)->batches == std::vector<std::vector<float>>{{2.0f, 4.0f}}));
+        CHECK(table.find_item(7) == nullptr);
+
+        // Delivering one key leaves the others staged, in their order
+        table.stage_push(push_msg(1, 7.0f));
+        table.stage_push(push_msg(3, 8.0f));
+        table.stage_push(push_msg(1, 9.0f));
+        table.stage_push(push_msg(3, 10.0f));
+        table.deliver_staged_pushes(1, false);
+        CHECK((table.find_item(1)->batches.back() == std::vector<float>{7.0f, 9.0f}));
+        CHECK(table.find_item(3)->batches.size() == 1);
+        CHECK(table.staged_pushes.size() == 2);
+        CHECK(table.staged_pushes[0].second == 8.0f);
+        CHECK(table.staged_pushes[1].second == 10.0f);
+
+        // Nothing staged for a key, nothing delivered
+        table.deliver_staged_pushes(1, false);
+        CHECK(table.find_item(1)->batches.size() == 2);
+
+        // Items are created on delivery when asked, but not in a frozen table, which drops the values as
+        // apply_push_to_item() does
+        table.stage_push(push_msg(7, 12.0f));
+        table.freeze();
+        table.deliver_staged_pushes(7, true);
+        CHECK(table.find_item(7) == nullptr);
+        CHECK(table.staged_pushes.size() == 2);
+        table.thaw();
+        table.stage_push(push_msg(7, 11.0f));
+        table.deliver_staged_pushes(true);
+        CHECK(table.find_item(7) != nullptr);
+        CHECK((table.find_item(7)->batches == std::vector<std::vector<float>>{{11.0f}}));
+        CHECK((table.find_item(3)->batches.back() == std::vector<float>{8.0f, 10.0f}));
+        table.destroy_items();
+    }
+
+    {
+        // A removal between two pushes to the same item: the first values reach the item before it is removed,
+        // and the value pushed after the removal does not recreate it
+        auto worker = saddlebags::create_worker<uint8_t, int, float>(1000);
+        worker->add_table<Sender>(0);
+        worker->add_table<Batched>(1);
+        worker->add_item<Sender>(0, 0);
+        worker->add_item<Batched>(1, 5);
+        auto six = worker->add_item<Batched>(1, 6);
+
+        worker->cycle(2);
+        CHECK((removed_batches == std::vector<std::vector<float>>{{1.0f, 2.0f}}));
+        CHECK(worker->count_items() == 2);
+        CHECK((six->batches == std::vector<std::vector<float>>{{10.0f, 20.0f}}));
+
+        worker = saddlebags::destroy_worker(worker);
+    }
+
+    saddlebags::finalize();
+    return saddlebags_test::result("push-batch");
+}
@@ -0,0 +1,107 @@
+// Copyright 2019 Saddlebag Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <vector>
+#include <upcxx/upcxx.hpp>
+#include "saddlebags.hpp"
+#include "check.hpp"
+
+//Checks of push_many: the ranks of a batch of keys are those of get_partition(), and each key receives
+//its values in the order they were pushed, also when push() and push_many() are mixed
+
+template<class TableKey_T, class ItemKey_T, class Msg_T>
+class Receiver : public saddlebags::Item<TableKey_T, ItemKey_T, Msg_T> {
+    public:
+    std::vector<Msg_T> received;
+
+    void on_push_recv(Msg_T val) override {
+        received.push_back(val);
+    }
+};
+
+template<class TableKey_T, class ItemKey_T, class Msg_T>
+class Sender : public saddlebags::Item<TableKey_T, ItemKey_T, Msg_T> {
+    public:
+    bool sent = false;
+
+    void do_work() override {
+        if (sent) {
+            return;
+        }
+        sent = true;
+        this->push(1, 5, 100.0f);
+        this->push_many(1, {5, 6, 7, 5}, 1.0f);
+        this->push_many(1, {7, 5, 5}, {2.0f, 3.0f, 4.0f});
+        this->push_many(1, {}, 9.0f);
+    }
+};
+
+int main(int argc, char* argv[]) {
+    saddlebags::init();
+
+    // The precomputed modulo of get_partitions() is exact for all 32-bit values
+    bool exact = true;
+    const uint32_t divisors[] = {1, 2, 3, 7, 64, 1000, 65537, 0x7FFFFFFF, 0xFFFFFFFF};
+    const uint32_t values[] = {0, 1, 2, 63, 64, 65, 999, 1000, 123456789, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFE, 0xFFFFFFFF};
+    for (auto d : divisors) {
+        uint64_t multiplier = saddlebags::fastmod_multiplier(d);
+        for (auto a : values) {
+            exact = exact && saddlebags::fastmod_u32(a, multiplier, d) == a % d;
+        }
+        for (uint32_t a = 0; a < 100000; a += 7) {
+            exact = exact && saddlebags::fastmod_u32(a * 2654435761u, multiplier, d) == (a * 2654435761u) % d;
+        }
+    }
+    CHECK(exact);
+
+    {
+        auto worker = saddlebags::create_worker<uint8_t, int, float>(1000);
+        worker->add_table<Sender>(0);
+        worker->add_table<Receiver>(1);
+
+        std::vector<int> keys;
+        for (int key = -50; key < 1000; key += 3) {
+            keys.push_back(key);
+        }
+        std::vector<std::size_t> ranks(keys.size(), 12345);
+        worker->get_partitions(1, keys.data(), keys.size(), ranks.data());
+        bool same = true;
+        for (std::size_t i = 0; i < keys.size(); i++) {
+            same = same && ranks[i] == worker->get_partition(1, keys[i]);
+        }
+        CHECK(same);
+
+        worker->add_item<Sender>(0, 0);
+        auto five = worker->add_item<Receiver>(1, 5);
+        auto six = worker->add_item<Receiver>(1, 6);
+        auto seven = worker->add_item<Receiver>(1, 7);
+
+        // The pushes of the first cycle arrive in the second one
+        worker->cycle(2);
+        CHECK((five->received == std::vector<float>{100.0f, 1.0f, 1.0f, 3.0f, 4.0f}));
+        CHECK((six->received == std::vector<float>{1.0f}));
+        CHECK((seven->received == std::vector<float>{1.0f, 2.0f}));
+
+        // Nothing is sent twice
+        worker->cycle(2);
+        CHECK(five->received.size() == 5);
+        CHECK(seven->received.size() == 2);
+
+        worker = saddlebags::destroy_worker(worker);
+    }
+
+    saddlebags::finalize();
+    return saddlebags_test::result("push-many");
+}
@@ -0,0 +1,279 @@
+// Copyright 2019 Saddlebag Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstdlib>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "hash_map.cpp"
+#include "check.hpp"
+
+//Checks of Robin_Map erase: entries of a cluster shift back into the hole, so that every key stays reachable
+//from its home slot without tombstones. Built once as is, and once with ROBIN_SWAPPING (robin-map-swapping).
+
+#ifdef ROBIN_SWAPPING
+#define TEST_NAME "robin-map-swapping"
+#else
+#define TEST_NAME "robin-map"
+#endif
+
+using Map = saddlebags::Robin_Map<int, int>;
+
+/**
+ * Keys whose home slot is home, in a map of size slots
+ */
+std::vector<int> keys_with_home(std::size_t size, std::size_t home, std::size_t count) {
+    std::vector<int> keys;
+    for (int key = 0; keys.size() < count; key++) {
+        if (saddlebags::bit_modulo(hashf(key), size) == home) {
+            keys.push_back(key);
+        }
+    }
+    return keys;
+}
+
+/**
+ * Linear probing finds a key only if no slot between its home and its slot is empty
+ */
+bool probe_paths_unbroken(Map& map) {
+    for (std::size_t location = 0; location < map.size; location++) {
+        if (!map.entries[location].occupied()) {
+            continue;
+        }
+        for (std::size_t s = saddlebags::bit_modulo(map.entries[location].hash, map.size); s != location;
+             s = saddlebags::bit_modulo(s + 1, map.size)) {
+            if (!map.entries[s].occupied()) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool all_found(Map& map, const std::vector<int>& keys) {
+    for (auto key : keys) {
+        auto location = map.find_location(key);
+        if (location == map.size || map.entries[location].second != key * 10) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool none_found(Map& map, const std::vector<int>& keys) {
+    for (auto key : keys) {
+        if (map.find_location(key) != map.size) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    {
+        // One cluster of three home slots next to each other, which collide and interleave
+        Map map;
+        std::vector<int> first = keys_with_home(map.size, 100, 5);
+        std::vector<int> second = keys_with_home(map.size, 101, 4);
+        std::vector<int> third = keys_with_home(map.size, 103, 3);
+        std::vector<int> all;
+        for (std::size_t i = 0; i < 5; i++) {
+            for (auto keys : {&first, &second, &third}) {
+                if (i < keys->size()) {
+                    map.insert((*keys)[i], (*keys)[i] * 10);
+                    all.push_back((*keys)[i]);
+                }
+            }
+        }
+        CHECK(map.num_items == 12);
+        CHECK(all_found(map, all));
+        CHECK(probe_paths_unbroken(map));
+
+        // Erase from the front, the middle and the end of the cluster
+        std::vector<int> erased = {first[0], second[2], third[2], first[4]};
+        for (auto key : erased) {
+            CHECK(map.erase(key));
+            CHECK(probe_paths_unbroken(map));
+        }
+        CHECK(!map.erase(first[0]));
+        CHECK(map.num_items == 8);
+        CHECK(none_found(map, erased));
+
+        std::vector<int> remaining;
+        for (auto key : all) {
+            if (std::find(erased.begin(), erased.end(), key) == erased.end()) {
+                remaining.push_back(key);
+            }
+        }
+        CHECK(all_found(map, remaining));
+
+        // The cluster is packed again: it ends right after its 8 entries
+        std::size_t occupied = 0;
+        for (std::size_t location = 100; location < 112; location++) {
+            occupied += map.entries[location].occupied() ? 1 : 0;
+        }
+        CHECK(occupied == 8);
+        CHECK(!map.entries[108].occupied());
+
+        for (auto key : erased) {
+            map.insert(key, key * 10);
+        }
+        CHECK(all_found(map, all));
+        CHECK(probe_paths_unbroken(map));
+    }
+
+    {
+        // A cluster that wraps around the end of the entries array
+        Map map;
+        std::vector<int> last = keys_with_home(map.size, map.size - 1, 4);
+        std::vector<int> first = keys_with_home(map.size, 0, 2);
+        for (auto key : last) {
+            map.insert(key, key * 10);
+        }
+        for (auto key : first) {
+            map.insert(key, key * 10);
+        }
+        CHECK(map.erase(last[1]));
+        CHECK(probe_paths_unbroken(map));
+        CHECK(map.erase(last[0]));
+        CHECK(probe_paths_unbroken(map));
+        CHECK(none_found(map, {last[0], last[1]}));
+        CHECK(all_found(map, {last[2], last[3], first[0], first[1]}));
+    }
+
+    {
+        // Random inserts and erases against std::unordered_map, through expansions
+        Map map;
+        std::unordered_map<int, int> reference;
+        std::srand(42);
+        for (int i = 0; i < 50000; i++) {
+            int key = std::rand() % 4000;
+            if (reference.count(key) == 0) {
+                map.insert(key, key * 10);
+                reference[key] = key * 10;
+            } else if (std::rand() % 2 == 0) {
+                CHECK(map.erase(key));
+                reference.erase(key);
+            }
+        }
+        CHECK(map.num_items == reference.size());
+        CHECK(probe_paths_unbroken(map));
+        std::vector<int> keys;
+        for (auto& entry : reference) {
+            keys.push_back(entry.first);
+        }
+        CHECK(all_found(map, keys));
+        std::size_t iterated = 0;
+        for (auto it = map.begin(); it != map.end(); ++it) {
+            iterated++;
+        }
+        CHECK(iterated == reference.size());
+    }
+
+    {
+        // reserve() grows the map once, so that loading the reserved keys does not expand it again
+        Map map;
+        map.reserve(3000);
+        CHECK(map.size == 8192);
+        std::vector<int> keys;
+        for (int key = 0; key < 3000; key++) {
+            map.insert(key, key * 10);
+            keys.push_back(key);
+        }
+        CHECK(map.size == 8192);
+        CHECK(all_found(map, keys));
+        // Reserving less than the map holds does not shrink it
+        map.reserve(10);
+        CHECK(map.size == 8192);
+    }
+
+    {
+        // build() adds keys in one pass to a map which already holds keys, some of them erased
+        Map map;
+        std::vector<int> keys;
+        for (int key = 0; key < 300; key++) {
+            map.insert(key, key * 10);
+            keys.push_back(key);
+        }
+        for (int key = 0; key < 300; key += 3) {
+            map.erase(key);
+        }
+        keys.erase(std::remove_if(keys.begin(), keys.end(), [](int key) { return key % 3 == 0; }), keys.end());
+
+        std::vector<int> added;
+        std::vector<int> values;
+        for (int key = 300; key < 5300; key++) {
+            added.push_back(key);
+            values.push_back(key * 10);
+        }
+        map.build(added.data(), values.data(), added.size());
+        CHECK(map.num_items == keys.size() + added.size());
+        CHECK(map.size == 16384);
+        CHECK(all_found(map, keys));
+        CHECK(all_found(map, added));
+        CHECK(none_found(map, {0, 3, 297, 5300}));
+        CHECK(probe_paths_unbroken(map));
+        std::size_t iterated = 0;
+        for (auto it = map.begin(); it != map.end(); ++it) {
+            iterated++;
+        }
+        CHECK(iterated == map.num_items);
+
+        // An empty build changes nothing
+        map.build(added.data(), values.data(), 0);
+        CHECK(map.num_items == keys.size() + added.size());
+    }
+
+    {
+        // Hashes keep all 64 bits, so that maps beyond 2^32 slots still spread keys over all of them
+        static_assert(std::is_same<decltype(Map::size), std::size_t>::value, "64-bit map size");
+        static_assert(std::is_same<decltype(Map::num_items), std::size_t>::value, "64-bit item count");
+        const std::size_t huge = (std::size_t) 1 << 40;
+        CHECK(saddlebags::bit_modulo(0x123456789abcdefULL, huge) == 0x6789abcdefULL);
+        CHECK(saddlebags::bit_modulo(0x123456789abcdefULL, 1024) == 0x1ef);
+
+        Map map;
+        std::size_t high_hashes = 0;
+        for (int key = 0; key < 100; key++) {
+            map.insert(key, key * 10);
+        }
+        for (std::size_t location = 0; location < map.size; location++) {
+            uint64_t hash = map.entries[location].hash & ~saddlebags::OCCUPIED_HASH_BIT;
+            high_hashes += map.entries[location].occupied() && (hash >> 32) != 0;
+        }
+        CHECK(high_hashes > 90);
+
+        // Distances to the home slot wrap around at the end of a map of 2^40 slots
+        saddlebags::Entry<int, int> entry;
+        entry.hash = huge - 2;
+        CHECK(map.get_offset(entry, 1, huge) == 3);
+        CHECK(map.get_offset(entry, huge - 1, huge) == 1);
+    }
+
+    {
+        // Occupancy is kept in the hash, so entries hold only the hash, key and value. A hash of 0 is still stored.
+        static_assert(sizeof(saddlebags::Entry<int, int>) == sizeof(uint64_t) + 2 * sizeof(int), "Entry has no flag");
+        Map map;
+        map.insert(7, 70, 0);
+        CHECK(map.entries[0].occupied());
+        CHECK(map.entries[0].first == 7);
+        CHECK(map.begin() != map.end() && (*map.begin()).second == 70);
+        map.clear();
+        CHECK(!map.entries[0].occupied());
+        CHECK(map.begin() == map.end());
+    }
+
+    return saddlebags_test::result(TEST_NAME);
+}
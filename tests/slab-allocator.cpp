@@ -0,0 +1,108 @@
+// Copyright 2019 Saddlebag Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <upcxx/upcxx.hpp>
+#include "item_allocator.cpp"
+#include "check.hpp"
+
+//Checks of ItemAllocator: slabs fill in order, removed items are reused from the free list,
+//and each item is destructed exactly once
+
+static int alive = 0;
+
+struct Counted {
+    int key;
+    Counted(int k) : key(k) {
+        alive++;
+    }
+    ~Counted() {
+        alive--;
+    }
+};
+
+int main(int argc, char* argv[]) {
+    {
+        saddlebags::ItemAllocator<Counted> allocator(4);
+        std::vector<Counted*> items;
+        for (int i = 0; i < 10; i++) {
+            items.push_back(allocator.allocate(i));
+        }
+        CHECK(alive == 10);
+        CHECK(allocator.num_items == 10);
+        CHECK(allocator.slabs.size() == 3);
+        CHECK(allocator.slab_used == 2);
+        CHECK(allocator.capacity_bytes() == 12 * sizeof(Counted));
+        // Items of one slab are adjacent, in insertion order
+        CHECK(items[1] == items[0] + 1 && items[3] == items[0] + 3);
+
+        allocator.deallocate(items[2]);
+        allocator.deallocate(items[5]);
+        CHECK(alive == 8);
+        CHECK(allocator.num_items == 8);
+        CHECK(allocator.free_list.size() == 2);
+
+        // The last freed space is reused first, before the current slab grows
+        Counted* reused = allocator.allocate(100);
+        CHECK(reused == items[5]);
+        CHECK(reused->key == 100);
+        reused = allocator.allocate(101);
+        CHECK(reused == items[2]);
+        CHECK(allocator.free_list.empty());
+        CHECK(allocator.slab_used == 2);
+        CHECK(allocator.slabs.size() == 3);
+
+        allocator.allocate(102);
+        allocator.allocate(103);
+        allocator.allocate(104);
+        CHECK(allocator.slabs.size() == 4);
+        CHECK(allocator.slab_used == 1);
+        CHECK(alive == 13);
+
+        // Removed items are not destructed again when the slabs are released
+        allocator.deallocate(items[0]);
+        allocator.deallocate(items[9]);
+        CHECK(alive == 11);
+        allocator.release();
+        CHECK(alive == 0);
+        CHECK(allocator.num_items == 0);
+        CHECK(allocator.slabs.empty());
+        CHECK(allocator.free_list.empty());
+
+        // The allocator is usable again after release()
+        allocator.allocate(1);
+        CHECK(alive == 1);
+        CHECK(allocator.slabs.size() == 1);
+    }
+    // The destructor releases the remaining items
+    CHECK(alive == 0);
+
+    {
+        saddlebags::ItemAllocator<Counted> first(2);
+        saddlebags::ItemAllocator<Counted> second(8);
+        Counted* kept = first.allocate(7);
+        first.allocate(8);
+        first.deallocate(kept);
+        first.swap(second);
+        CHECK(second.num_items == 1);
+        CHECK(second.slab_size == 2);
+        CHECK(second.free_list.size() == 1);
+        CHECK(first.num_items == 0);
+        CHECK(first.slab_size == 8);
+        CHECK(second.allocate(9) == kept);
+    }
+    CHECK(alive == 0);
+
+    return saddlebags_test::result("slab-allocator");
+}
@@ -0,0 +1,181 @@
+// Copyright 2019 Saddlebag Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+#include <upcxx/upcxx.hpp>
+#include "saddlebags.hpp"
+#include "check.hpp"
+
+//Checks of SlimItem: the header holds only the slot, the table keeps the keys through removals and freezing,
+//and the hooks get the Worker, table and key as context
+
+const int RING_SIZE = 50;
+
+template<class TableKey_T, class ItemKey_T, class Msg_T>
+class Empty : public saddlebags::SlimItem<Empty<TableKey_T, ItemKey_T, Msg_T>, TableKey_T, ItemKey_T, Msg_T> {
+};
+
+template<class TableKey_T, class ItemKey_T, class Msg_T>
+class Ring : public saddlebags::SlimItem<Ring<TableKey_T, ItemKey_T, Msg_T>, TableKey_T, ItemKey_T, Msg_T> {
+    public:
+    using Context = typename Ring::Context;
+
+    // Key and slot as seen by the hooks
+    ItemKey_T created_key = -1;
+    ItemKey_T work_key = -1;
+    std::size_t work_slot = 0;
+    Msg_T received = 0;
+    int pushes = 0;
+    int removed = 0;
+
+    void on_create(const Context& context) {
+        created_key = context.myItemKey;
+    }
+
+    void on_push_recv(const Context& context, Msg_T val) {
+        received += val;
+        pushes++;
+    }
+
+    void on_remove(const Context& context) {
+        removed++;
+    }
+
+    void do_work(const Context& context) {
+        work_key = context.myItemKey;
+        work_slot = context.table_slot;
+        if (context.worker != nullptr) {
+            context.push(context.myTableKey, (context.myItemKey + 1) % RING_SIZE, (Msg_T) context.myItemKey);
+        }
+    }
+};
+
+template<class TableKey_T, class ItemKey_T, class Msg_T>
+class Full : public saddlebags::Item<TableKey_T, ItemKey_T, Msg_T> {
+};
+
+template<class TableKey_T, class ItemKey_T, class Msg_T>
+class Static : public saddlebags::StaticItem<Static<TableKey_T, ItemKey_T, Msg_T>, TableKey_T, ItemKey_T, Msg_T> {
+};
+
+using RingItem = Ring<uint8_t, int, float>;
+using Table = saddlebags::TableContainer<uint8_t, int, float, RingItem>;
+
+/**
+ * Every item was created, and last ran, with its own key and slot
+ */
+bool keys_in_slots(Table& table) {
+    if (table.slot_keys.size() != table.work_items.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < table.work_items.size(); i++) {
+        auto obj = table.work_items[i];
+        if (obj->table_slot != i || obj->created_key != table.slot_keys[i] || table.find_item(obj->created_key) != obj) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool work_saw_keys(Table& table) {
+    for (std::size_t i = 0; i < table.work_items.size(); i++) {
+        auto obj = table.work_items[i];
+        if (obj->work_key != obj->created_key || obj->work_slot != i) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    saddlebags::init();
+
+    // The header of a slim item is its slot, and the full headers have 32-bit slots as well
+    CHECK(sizeof(Empty<uint8_t, unsigned int, float>) == sizeof(saddlebags::ItemSlot));
+    CHECK(sizeof(Empty<uint8_t, unsigned int, double>) == sizeof(saddlebags::ItemSlot));
+    CHECK(sizeof(Static<uint8_t, unsigned int, float>) == 24);
+    CHECK(sizeof(Full<uint8_t, unsigned int, float>) == 32);
+    CHECK((!saddlebags::has_push_batch<RingItem, uint8_t, int, float>::value));
+
+    {
+        Table table;
+        table.myTableKey = 0;
+        table.worker = nullptr;
+        for (int key = 0; key < 200; key++) {
+            table.add_new_item(key * 3);
+        }
+        CHECK(table.work_items.size() == 200);
+        CHECK(keys_in_slots(table));
+
+        // The key of the last item follows it into the hole
+        CHECK(table.remove_item(0));
+        CHECK(table.remove_item(300));
+        CHECK(!table.remove_item(300));
+        CHECK(table.find_item(300) == nullptr);
+        CHECK(keys_in_slots(table));
+
+        table.work();
+        CHECK(work_saw_keys(table));
+
+        table.push_to_item(table.find_item(9), 2.0f);
+        table.push_to_item(table.find_item(9), 0.5f);
+        CHECK(table.find_item(9)->received == 2.5f);
+
+        // Freezing moves the items into key order, and their keys with them
+        table.freeze();
+        CHECK(keys_in_slots(table));
+        CHECK(table.slot_keys.front() == 3);
+        CHECK(table.slot_keys.back() == 597);
+        CHECK(table.find_item(9)->received == 2.5f);
+        table.work();
+        CHECK(work_saw_keys(table));
+        table.thaw();
+
+        // get_items() lists the keys
+        std::size_t listed = 0;
+        for (auto it = table.get_items()->begin(); it != table.get_items()->end(); ++it) {
+            listed += table.find_item((*it).first) != nullptr;
+        }
+        CHECK(listed == 198);
+
+        saddlebags::TableMemory memory;
+        table.account_memory(memory);
+        CHECK(memory.list_bytes >= 198 * (sizeof(RingItem*) + sizeof(int)));
+
+        table.destroy_items();
+        CHECK(table.slot_keys.empty());
+    }
+
+    {
+        // Items push through their context: each item sends its key to the next one of the ring, every cycle.
+        // A cycle receives the pushes of the previous one, so 3 cycles deliver twice.
+        auto worker = saddlebags::create_worker<uint8_t, int, float>(1000);
+        worker->add_table<Ring>(0);
+        std::vector<RingItem*> ring;
+        for (int key = 0; key < RING_SIZE; key++) {
+            ring.push_back(worker->add_item<Ring>(0, key));
+        }
+        worker->cycle(3);
+        bool delivered = true;
+        for (int key = 0; key < RING_SIZE; key++) {
+            float from = (float) ((key + RING_SIZE - 1) % RING_SIZE);
+            delivered = delivered && ring[key]->pushes == 2 && ring[key]->received == 2 * from && ring[key]->work_key == key;
+        }
+        CHECK(delivered);
+        worker = saddlebags::destroy_worker(worker);
+    }
+
+    saddlebags::finalize();
+    return saddlebags_test::result("slim-item");
+}
@@ -0,0 +1,153 @@
+// Copyright 2019 Saddlebag Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+#include <upcxx/upcxx.hpp>
+#include "saddlebags.hpp"
+#include "check.hpp"
+
+//Checks of StaticItem: tables call the hooks redefined by the item type, without a vtable, and the defaults
+//of the others. Batched pushes and memory accounting are detected from the redefined hooks.
+
+static int works = 0;
+static int befores = 0;
+static int removes = 0;
+
+template<class TableKey_T, class ItemKey_T, class Msg_T>
+class Counter : public saddlebags::StaticItem<Counter<TableKey_T, ItemKey_T, Msg_T>, TableKey_T, ItemKey_T, Msg_T> {
+    public:
+    Msg_T received = 0;
+    int created = 0;
+
+    void on_create() {
+        created++;
+    }
+
+    void on_push_recv(Msg_T val) {
+        received += val;
+    }
+
+    void on_remove() {
+        removes++;
+    }
+
+    void do_work() {
+        works++;
+    }
+};
+
+template<class TableKey_T, class ItemKey_T, class Msg_T>
+class Batched : public saddlebags::StaticItem<Batched<TableKey_T, ItemKey_T, Msg_T>, TableKey_T, ItemKey_T, Msg_T> {
+    public:
+    std::vector<Msg_T> batches;
+    std::vector<int> links;
+
+    void on_push_batch(const Msg_T* vals, std::size_t n) {
+        batches.push_back(vals[0]);
+        for (std::size_t i = 1; i < n; i++) {
+            batches.back() += vals[i];
+        }
+    }
+
+    void before_work() {
+        befores++;
+    }
+
+    std::size_t memory_bytes() {
+        return links.capacity() * sizeof(int);
+    }
+};
+
+template<class TableKey_T, class ItemKey_T, class Msg_T>
+class Virtual : public saddlebags::Item<TableKey_T, ItemKey_T, Msg_T> {
+    public:
+    void on_push_batch(const Msg_T* vals, std::size_t n) override {
+    }
+};
+
+using CounterItem = Counter<uint8_t, int, float>;
+using BatchedItem = Batched<uint8_t, int, float>;
+
+int main(int argc, char* argv[]) {
+    saddlebags::init();
+
+    // The only difference to the header of an Item is the vtable pointer
+    static_assert(!std::is_polymorphic<CounterItem>::value, "StaticItems have no vtable");
+    CHECK(sizeof(saddlebags::StaticItem<CounterItem, uint8_t, unsigned int, float>) == 24);
+    CHECK(sizeof(saddlebags::StaticItem<CounterItem, uint8_t, unsigned int, float>) + sizeof(void*)
+          == sizeof(saddlebags::Item<uint8_t, unsigned int, float>));
+
+    CHECK((!saddlebags::has_push_batch<CounterItem, uint8_t, int, float>::value));
+    CHECK((saddlebags::has_push_batch<BatchedItem, uint8_t, int, float>::value));
+    CHECK((saddlebags::has_push_batch<Virtual<uint8_t, int, float>, uint8_t, int, float>::value));
+    CHECK((!saddlebags::has_push_batch<saddlebags::Item<uint8_t, int, float>, uint8_t, int, float>::value));
+    CHECK(!saddlebags::has_memory_bytes<CounterItem>::value);
+    CHECK(saddlebags::has_memory_bytes<BatchedItem>::value);
+
+    {
+        saddlebags::TableContainer<uint8_t, int, float, CounterItem> table;
+        table.myTableKey = 0;
+        table.worker = nullptr;
+        for (int key = 0; key < 10; key++) {
+            table.add_new_item(key);
+        }
+        CHECK(table.find_item(4)->created == 1);
+        CHECK(table.find_item(4)->myItemKey == 4);
+
+        works = 0;
+        table.work();
+        CHECK(works == 10);
+
+        table.push_to_item(table.find_item(4), 1.5f);
+        table.push_to_slot(table.find_item(5)->table_slot, 2.0f);
+        CHECK(table.find_item(4)->received == 1.5f);
+        CHECK(table.find_item(5)->received == 2.0f);
+
+        removes = 0;
+        CHECK(table.remove_item(4));
+        CHECK(removes == 1);
+        table.destroy_items();
+    }
+
+    {
+        // Pushes to a batching item are staged, and handed over per item, in the order they came
+        saddlebags::TableContainer<uint8_t, int, float, BatchedItem> table;
+        table.myTableKey = 0;
+        table.worker = nullptr;
+        table.batch_pushes = true;
+        table.add_new_item(1);
+        table.add_new_item(2);
+        table.push_to_slot(table.find_item(1)->table_slot, 1.0f);
+        table.push_to_slot(table.find_item(2)->table_slot, 10.0f);
+        table.push_to_slot(table.find_item(1)->table_slot, 2.0f);
+        CHECK(table.find_item(1)->batches.empty());
+        table.deliver_staged_pushes(false);
+        CHECK((table.find_item(1)->batches == std::vector<float>{3.0f}));
+        CHECK((table.find_item(2)->batches == std::vector<float>{10.0f}));
+        CHECK(table.staged_pushes.empty());
+
+        befores = 0;
+        table.work();
+        CHECK(befores == 2);
+
+        table.find_item(1)->links.resize(8);
+        saddlebags::TableMemory memory;
+        table.account_memory(memory);
+        CHECK(memory.user_bytes == table.find_item(1)->links.capacity() * sizeof(int));
+        table.destroy_items();
+    }
+
+    saddlebags::finalize();
+    return saddlebags_test::result("static-item");
+}
@@ -0,0 +1,171 @@
+// Copyright 2019 Saddlebag Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+#include "swiss_map.cpp"
+#include "check.hpp"
+
+//Checks of Swiss_Map: erasing from a full group leaves a tombstone that lookups probe past and inserts reuse,
+//erasing from a group with an empty slot does not, and rehashing drops the tombstones
+
+using Map = saddlebags::Swiss_Map<int, int>;
+
+/**
+ * Keys whose probe sequence starts at group 0 of a map of size slots
+ */
+std::vector<int> keys_of_first_group(std::size_t size, std::size_t count) {
+    std::vector<int> keys;
+    std::size_t num_groups = size / saddlebags::SWISS_GROUP_SIZE;
+    for (int key = 0; keys.size() < count; key++) {
+        if ((((std::size_t) hashf(key) >> 7) & (num_groups - 1)) == 0) {
+            keys.push_back(key);
+        }
+    }
+    return keys;
+}
+
+bool all_found(Map& map, const std::vector<int>& keys, std::size_t skip = (std::size_t) -1) {
+    for (std::size_t i = 0; i < keys.size(); i++) {
+        if (i == skip) {
+            continue;
+        }
+        auto it = map.find(keys[i]);
+        if (it == map.end() || (*it).second != keys[i] * 10) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    Map map;
+    std::vector<int> keys = keys_of_first_group(map.size, 41);
+    int spare = keys.back();
+    keys.pop_back();
+
+    // 16 keys fill group 0, the others spill over to the next groups of the probe sequence
+    for (auto key : keys) {
+        map.insert(key, key * 10);
+    }
+    CHECK(map.num_items == 40);
+    CHECK(map.num_deleted == 0);
+    CHECK(all_found(map, keys));
+
+    std::size_t in_first_group = 0;
+    std::size_t spilled = 0;
+    for (std::size_t i = 0; i < keys.size(); i++) {
+        std::size_t location = map.find(keys[i]).current_loc;
+        if (location < saddlebags::SWISS_GROUP_SIZE) {
+            in_first_group = i;
+        } else {
+            spilled = i;
+        }
+    }
+
+    // Group 0 is full, so its slot becomes a tombstone, and keys beyond it are still found
+    std::size_t tombstone = map.find(keys[in_first_group]).current_loc;
+    CHECK(map.erase(keys[in_first_group]));
+    CHECK(map.ctrl[tombstone] == saddlebags::SWISS_CTRL_DELETED);
+    CHECK(map.num_deleted == 1);
+    CHECK(map.num_items == 39);
+    CHECK(map.find(keys[in_first_group]) == map.end());
+    CHECK(all_found(map, keys, in_first_group));
+    CHECK(!map.erase(keys[in_first_group]));
+
+    // The last group of the probe sequence has empty slots, so no tombstone is needed there
+    std::size_t location = map.find(keys[spilled]).current_loc;
+    CHECK(map.erase(keys[spilled]));
+    CHECK(map.ctrl[location] == saddlebags::SWISS_CTRL_EMPTY);
+    CHECK(map.num_deleted == 1);
+
+    // A new key of the same group takes the tombstone, the first free slot of its probe sequence
+    map.insert(spare, spare * 10);
+    CHECK(map.num_deleted == 0);
+    CHECK(map.find(spare).current_loc == tombstone);
+    CHECK((*map.find(spare)).second == spare * 10);
+    map.insert(keys[spilled], keys[spilled] * 10);
+
+    // Rehashing at the same size drops tombstones
+    map.insert(keys[in_first_group], keys[in_first_group] * 10);
+    for (std::size_t i = 0; i < 8; i++) {
+        map.erase(keys[i]);
+    }
+    CHECK(map.num_deleted > 0);
+    std::size_t size = map.size;
+    map.expand(map.size);
+    CHECK(map.size == size);
+    CHECK(map.num_deleted == 0);
+    CHECK(map.num_items == 33);
+    std::vector<int> remaining(keys.begin() + 8, keys.end());
+    remaining.push_back(spare);
+    CHECK(all_found(map, remaining));
+    for (std::size_t i = 0; i < 8; i++) {
+        CHECK(map.find(keys[i]) == map.end());
+    }
+
+    std::size_t iterated = 0;
+    for (auto it = map.begin(); it != map.end(); ++it) {
+        iterated++;
+    }
+    CHECK(iterated == map.num_items);
+
+    // Churn through many keys: tombstones never exceed the load factor, and live keys stay reachable
+    Map churn;
+    std::vector<int> live;
+    for (int key = 0; key < 20000; key++) {
+        churn.insert(key, key * 10);
+        live.push_back(key);
+        if (live.size() > 500) {
+            churn.erase(live.front());
+            live.erase(live.begin());
+        }
+        if (churn.num_items + churn.num_deleted > churn.size * churn.load_factor) {
+            CHECK(false);
+            break;
+        }
+    }
+    CHECK(churn.num_items == 500);
+    CHECK(all_found(churn, live));
+
+    map.clear();
+    CHECK(map.num_items == 0 && map.num_deleted == 0);
+    CHECK(map.begin() == map.end());
+
+    // build() reserves once for all keys, on top of the keys already in the map
+    Map built;
+    std::vector<int> first;
+    for (int key = 0; key < 100; key++) {
+        built.insert(key, key * 10);
+        first.push_back(key);
+    }
+    std::vector<int> added;
+    std::vector<int> values;
+    for (int key = 100; key < 4100; key++) {
+        added.push_back(key);
+        values.push_back(key * 10);
+    }
+    std::size_t expected_size = built.size;
+    while (expected_size * built.load_factor < 4100) {
+        expected_size *= 2;
+    }
+    built.build(added.data(), values.data(), added.size());
+    CHECK(built.size == expected_size);
+    CHECK(built.num_items == 4100);
+    CHECK(all_found(built, first));
+    CHECK(all_found(built, added));
+    built.reserve(10);
+    CHECK(built.size == expected_size);
+
+    return saddlebags_test::result("swiss-map");
+}
@@ -0,0 +1,131 @@
+// Copyright 2019 Saddlebag Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+#include <string>
+#include <upcxx/upcxx.hpp>
+#include "saddlebags.hpp"
+#include "check.hpp"
+
+//Checks of Tracer: the events it records, the Chrome trace JSON it writes, and events dropped once the
+//buffer is full
+
+std::vector<std::string> lines(const std::string& text) {
+    std::vector<std::string> result;
+    std::istringstream in(text);
+    std::string line;
+    while (std::getline(in, line)) {
+        result.push_back(line);
+    }
+    return result;
+}
+
+bool contains(const std::string& text, const std::string& part) {
+    return text.find(part) != std::string::npos;
+}
+
+int main(int argc, char* argv[]) {
+    saddlebags::init();
+
+    {
+        // A disabled tracer records nothing, and writes an empty list
+        saddlebags::Tracer tracer;
+        tracer.begin("cycle", 0);
+        tracer.lap(saddlebags::PhaseWork);
+        CHECK(tracer.events.empty());
+        std::ostringstream json;
+        tracer.write_json(json, 0);
+        CHECK(json.str() == "[\n]\n");
+    }
+
+    {
+        saddlebags::Tracer tracer;
+        tracer.enable(16);
+        tracer.begin("cycle", 7);
+        tracer.begin_laps();
+        tracer.lap(saddlebags::PhaseBarrier);
+        tracer.begin_async("rget", 2);
+        tracer.end_async("rget", 2);
+        tracer.lap(saddlebags::PhaseBufferRget);
+        tracer.end("cycle", 7);
+        tracer.begin("flush");
+
+        CHECK(tracer.events.size() == 7);
+        CHECK(tracer.dropped == 0);
+        const char phases[] = {'B', 'X', 'b', 'e', 'X', 'E', 'B'};
+        bool in_order = true;
+        for (std::size_t i = 0; i < tracer.events.size(); i++) {
+            in_order = in_order && tracer.events[i].phase == phases[i];
+        }
+        CHECK(in_order);
+        // Spans of phases are recorded when they end, with the time they started
+        CHECK(tracer.events[1].ts_us >= tracer.events[0].ts_us);
+        CHECK(tracer.events[3].ts_us >= tracer.events[2].ts_us);
+        CHECK(tracer.events[4].ts_us <= tracer.events[2].ts_us);
+        CHECK(tracer.events[5].ts_us >= tracer.events[4].ts_us);
+        CHECK(tracer.events[1].dur_us >= 0 && tracer.events[4].dur_us >= 0);
+        CHECK(std::string(tracer.events[1].name) == "barrier");
+        CHECK(std::string(tracer.events[4].name) == "buffer_rget");
+        // A lap spans from the previous lap
+        CHECK(tracer.events[4].ts_us >= tracer.events[1].ts_us);
+
+        std::ostringstream out;
+        tracer.write_json(out, 3);
+        auto json = lines(out.str());
+        CHECK(json.size() == 9);
+        CHECK(json.front() == "[");
+        CHECK(json.back() == "]");
+        bool well_formed = true;
+        for (std::size_t i = 1; i + 1 < json.size(); i++) {
+            well_formed = well_formed && json[i].front() == '{'
+                && json[i].substr(json[i].size() - (i + 2 < json.size() ? 2 : 1)) == (i + 2 < json.size() ? "}," : "}")
+                && contains(json[i], "\"pid\": 3, \"tid\": 0");
+        }
+        CHECK(well_formed);
+        CHECK(contains(json[1], "{\"name\": \"cycle\", \"ph\": \"B\""));
+        CHECK(contains(json[1], "\"args\": {\"value\": 7}"));
+        CHECK(contains(json[2], "\"ph\": \"X\"") && contains(json[2], "\"dur\": "));
+        CHECK(!contains(json[2], "\"args\""));
+        CHECK(contains(json[3], "\"cat\": \"comm\", \"id\": 2, \"args\": {\"peer\": 2}"));
+        CHECK(!contains(json[7], "\"args\""));
+        // Timestamps are printed in full, not in scientific notation
+        CHECK(!contains(json[1], "e+"));
+    }
+
+    {
+        // Events beyond the capacity are dropped, and counted in one instant event at the end
+        saddlebags::Tracer tracer;
+        tracer.enable(2);
+        std::size_t capacity = tracer.events.capacity();
+        for (int i = 0; i < 10; i++) {
+            tracer.begin("cycle", i);
+        }
+        CHECK(tracer.events.size() == capacity);
+        CHECK(tracer.dropped == 10 - capacity);
+        std::ostringstream out;
+        tracer.write_json(out, 0);
+        auto json = lines(out.str());
+        CHECK(json.size() == capacity + 3);
+        CHECK(contains(json[capacity + 1], "\"name\": \"dropped_events\", \"ph\": \"i\""));
+        CHECK(contains(json[capacity + 1], "\"args\": {\"count\": " + std::to_string(10 - capacity) + "}}"));
+
+        // Enabling again starts a new trace
+        tracer.enable(4);
+        CHECK(tracer.events.empty());
+        CHECK(tracer.dropped == 0);
+    }
+
+    saddlebags::finalize();
+    return saddlebags_test::result("trace");
+}
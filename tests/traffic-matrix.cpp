@@ -0,0 +1,72 @@
+// Copyright 2019 Saddlebag Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+#include <string>
+#include <upcxx/upcxx.hpp>
+#include "saddlebags.hpp"
+#include "check.hpp"
+
+//Checks of TrafficMatrix: totals and the last cycle that communicated, the row gathered from each rank,
+//and the CSV of the whole matrix
+
+int main(int argc, char* argv[]) {
+    saddlebags::init();
+
+    {
+        // Nothing is counted before enable()
+        saddlebags::TrafficMatrix traffic;
+        traffic.add(0, 5, 40);
+        traffic.end_cycle();
+        CHECK(traffic.total_messages.empty());
+        CHECK(traffic.row(false).empty());
+    }
+
+    {
+        saddlebags::TrafficMatrix traffic;
+        traffic.enable(3);
+        traffic.add(0, 2, 16);
+        traffic.add(2, 1, 8);
+        traffic.add(2, 3, 12);
+        traffic.end_cycle();
+        traffic.add(1, 4, 32);
+        traffic.end_cycle();
+
+        CHECK((traffic.total_messages == std::vector<uint64_t>{2, 4, 4}));
+        CHECK((traffic.total_bytes == std::vector<uint64_t>{16, 32, 20}));
+        CHECK((traffic.cycle_messages == std::vector<uint64_t>{0, 4, 0}));
+        CHECK((traffic.cycle_bytes == std::vector<uint64_t>{0, 32, 0}));
+        CHECK((traffic.pending_messages == std::vector<uint64_t>{0, 0, 0}));
+        CHECK((traffic.row(false) == std::vector<uint64_t>{2, 4, 4, 16, 32, 20}));
+        CHECK((traffic.row(true) == std::vector<uint64_t>{0, 4, 0, 0, 32, 0}));
+
+        // Messages added after the last end_cycle() count in the totals, but not yet in the cycle
+        traffic.add(0, 1, 8);
+        CHECK(traffic.total_messages[0] == 3);
+        CHECK(traffic.cycle_messages[0] == 0);
+    }
+
+    {
+        // Rows of src 0 and 1, as gathered on rank 0
+        saddlebags::TrafficMatrix traffic;
+        std::vector<uint64_t> messages = {0, 7, 3, 1};
+        std::vector<uint64_t> bytes = {0, 56, 24, 8};
+        std::ostringstream csv;
+        traffic.write_csv(csv, messages, bytes, 2);
+        CHECK(csv.str() == "src,dest,messages,bytes\n0,0,0,0\n0,1,7,56\n1,0,3,24\n1,1,1,8\n");
+    }
+
+    saddlebags::finalize();
+    return saddlebags_test::result("traffic-matrix");
+}
@@ -0,0 +1,131 @@
+// Copyright 2019 Saddlebag Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+#include <upcxx/upcxx.hpp>
+#include "saddlebags.hpp"
+#include "check.hpp"
+
+//Checks of vote to halt: items keep running every cycle until they vote to halt, a message wakes them up again,
+//and cycle() returns once all items are halted and no message is left
+
+const int ITEMS = 10;
+
+template<class TableKey_T, class ItemKey_T, class Msg_T>
+class Countdown : public saddlebags::Item<TableKey_T, ItemKey_T, Msg_T> {
+    public:
+    int budget = 0;
+    int runs = 0;
+    int received = 0;
+
+    void on_create() override {
+        budget = this->myItemKey;
+    }
+
+    void do_work() override {
+        runs++;
+        // Items of a table without a Worker only count their runs
+        if (budget > 0 || this->worker == nullptr) {
+            budget--;
+            return;
+        }
+        // The last item to halt wakes the first one up again, once
+        if (this->myItemKey == ITEMS - 1) {
+            this->push(this->myTableKey, 0, 1.0f);
+        }
+        this->vote_to_halt();
+    }
+
+    void on_push_recv(Msg_T val) override {
+        received++;
+    }
+};
+
+using CountdownItem = Countdown<uint8_t, int, float>;
+using Table = saddlebags::TableContainer<uint8_t, int, float, CountdownItem>;
+
+int main(int argc, char* argv[]) {
+    saddlebags::init();
+
+    {
+        Table t;
+        t.myTableKey = 0;
+        t.worker = nullptr;
+        t.active_scheduling = true;
+        t.keep_active = true;
+        for (int key = 0; key < 100; key++) {
+            t.add_new_item(key);
+        }
+
+        // Items which did not halt stay active, across words of bits
+        t.work();
+        CHECK(t.count_active() == 100);
+        t.halt_slot(t.find_item(3)->table_slot);
+        t.halt_slot(t.find_item(80)->table_slot);
+        t.work();
+        CHECK(t.count_active() == 98);
+        t.work();
+        CHECK(t.count_active() == 98);
+        CHECK(t.find_item(80)->runs == 2);
+
+        // A message wakes a halted item up, which then runs every cycle again
+        t.push_to_item(t.find_item(80), 1.0f);
+        t.work();
+        t.work();
+        CHECK(t.count_active() == 99);
+        CHECK(t.find_item(80)->runs == 4);
+
+        // Halted bits follow the items that fill the holes of removed ones
+        t.halt_slot(t.find_item(99)->table_slot);
+        CHECK(t.remove_item(0));
+        t.work();
+        CHECK(t.find_item(99)->table_slot == 0);
+        CHECK(t.count_active() == 97);
+        t.destroy_items();
+    }
+
+    {
+        auto worker = saddlebags::create_worker<uint8_t, int, float>(1000);
+        worker->add_table<Countdown>(0);
+        std::vector<CountdownItem*> items;
+        for (int key = 0; key < ITEMS; key++) {
+            items.push_back(worker->add_item<Countdown>(0, key));
+        }
+        worker->enable_vote_to_halt(0);
+        CHECK(!worker->is_halted());
+
+        // Item k runs k + 1 times. The last one halts in cycle ITEMS - 1, and its message to item 0 is
+        // received and run in the next cycle, after which nothing is left.
+        int cycles = worker->cycle(100);
+        CHECK(worker->is_halted());
+        CHECK(cycles == ITEMS + 1);
+        bool counted = true;
+        for (int key = 1; key < ITEMS; key++) {
+            counted = counted && items[key]->runs == key + 1;
+        }
+        CHECK(counted);
+        CHECK(items[0]->runs == 2);
+        CHECK(items[0]->received == 1);
+        CHECK(worker->count_active() == 0);
+
+        // A halted job stays halted
+        CHECK(worker->cycle(5) == 0);
+        CHECK(items[0]->runs == 2);
+
+        worker = saddlebags::destroy_worker(worker);
+    }
+
+    saddlebags::finalize();
+    return saddlebags_test::result("vote-to-halt");
+}
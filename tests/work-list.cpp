@@ -0,0 +1,131 @@
+// Copyright 2019 Saddlebag Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+#include <upcxx/upcxx.hpp>
+#include "saddlebags.hpp"
+#include "check.hpp"
+
+//Checks of the packed item list: work() runs every item once, also when the work hooks remove items,
+//which are released only after all hooks ran, and the list stays packed with each item at its slot
+
+template<class TableKey_T, class ItemKey_T, class Msg_T> class Worklet;
+using WorkletItem = Worklet<uint8_t, int, float>;
+using Table = saddlebags::TableContainer<uint8_t, int, float, WorkletItem>;
+
+static Table* table = nullptr;
+static std::vector<int> ran;
+static int removes = 0;
+
+template<class TableKey_T, class ItemKey_T, class Msg_T>
+class Worklet : public saddlebags::Item<TableKey_T, ItemKey_T, Msg_T> {
+    public:
+    // Keys to remove when this item runs
+    std::vector<ItemKey_T> victims;
+
+    void do_work() override {
+        ran.push_back(this->myItemKey);
+        for (auto key : victims) {
+            table->remove_item(key);
+        }
+    }
+
+    void on_remove() override {
+        removes++;
+    }
+};
+
+bool packed(Table& t) {
+    for (std::size_t i = 0; i < t.work_items.size(); i++) {
+        if (t.work_items[i]->table_slot != i || t.find_item(t.work_items[i]->myItemKey) != t.work_items[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ran_once(int n, const std::vector<int>& skipped) {
+    std::vector<int> counts(n, 0);
+    for (auto key : ran) {
+        counts[key]++;
+    }
+    for (int key = 0; key < n; key++) {
+        bool skip = false;
+        for (auto s : skipped) {
+            skip = skip || s == key;
+        }
+        if (counts[key] != (skip ? 0 : 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    saddlebags::init();
+
+    for (int active = 0; active < 2; active++) {
+        Table t;
+        t.myTableKey = 0;
+        t.worker = nullptr;
+        table = &t;
+        t.active_scheduling = active == 1;
+        for (int key = 0; key < 20; key++) {
+            t.add_new_item(key);
+        }
+        t.activate_all();
+
+        // Items remove themselves, items that ran before them, items after them, and a missing key
+        t.find_item(3)->victims = {3};
+        t.find_item(5)->victims = {1, 18, 99};
+        t.find_item(19)->victims = {0, 5};
+
+        ran.clear();
+        removes = 0;
+        t.work();
+        // The list does not change while the hooks run, so every item ran once, including those removed
+        CHECK(ran_once(20, {}));
+        CHECK(removes == 5);
+        CHECK(t.work_items.size() == 15);
+        CHECK(packed(t));
+        for (auto key : {0, 1, 3, 5, 18}) {
+            CHECK(t.find_item(key) == nullptr);
+        }
+        CHECK(t.deferred_removals.empty());
+        CHECK(!t.in_work);
+
+        // Outside of work(), removals apply right away
+        CHECK(t.remove_item(7));
+        CHECK(!t.remove_item(7));
+        CHECK(t.work_items.size() == 14);
+        CHECK(packed(t));
+
+        // The next work() runs the remaining items only
+        for (auto obj : t.work_items) {
+            obj->victims.clear();
+        }
+        t.activate_all();
+        ran.clear();
+        t.work();
+        CHECK(ran_once(20, {0, 1, 3, 5, 7, 18}));
+
+        // Items added after removals take the next slots
+        t.add_new_item(100);
+        CHECK(t.find_item(100)->table_slot == 14);
+        CHECK(packed(t));
+    }
+
+    saddlebags::finalize();
+    return saddlebags_test::result("work-list");
+}